@@ -5,49 +5,869 @@
 #include <stdint.h>
 
 #include "./controller.h"
+#include "./sysclock.h"
 #include "./adc.h"
+#include "./adccal.h"
+#include "./psu.h"
+#include "./cfgeeprom.h"
+#include "./pwmout.h"
 
 #ifdef __cplusplus
     extern "C" {
 #endif
 
 /*
-    The ISR simply switches to the next MUX (the next conversion should already
-    be running) and stores the current measured value in our own shadow registers.
+    The ISR simply switches to the next MUX according to the scan table (the
+    next conversion should already be running) and accumulates the measured
+    value in our own shadow registers.
+
+    Oversampling / decimation:
+
+        Each channel accumulates adcDecimationScans passes through the scan
+        table (1, 4, 16 or 64) times its weight conversions. Summing 4^n
+        samples and dividing by 2^n yields n additional bits of
+        resolution (10+n bits). The result is always published normalized to
+        ADC_OVERSAMPLED_BITS so consumers do not have to care about the
+        currently selected decimation.
+
+        The accumulator is published while the last pass of a block is running
+        (each channel at the time its last conversion arrives) so the ISR never
+        has to touch all channels at once.
+
+    Double buffering:
+
+        Values are published into the bank that is currently not visible to
+        readers. After the last entry of the last pass has been published
+        the banks are swapped and adcSequence is incremented. A reader
+        (adcGetSnapshot) copies the visible bank and only has to disable
+        interrupts while fetching bank index and sequence number - if the
+        sequence changed during the copy it simply retries. This guarantees
+        that voltage and current of every PSU originate from the same block.
+
+    Statistics:
+
+        Additionally min, max, sum and count of the raw conversions are
+        tracked per channel so transients can be queried without polling
+        at high rate. A statistics entry restarts with the next sample when
+        it has been fetched (count reset to 0) or when adcStatisticsWindow
+        samples have been collected (0 disables the window).
 */
 static uint8_t adcCurrentMux;
 
-#ifndef ADC_CHANNELS16
-    uint16_t currentADC[8];
-    #define ADC_CHANNEL_COUNT 8
-#else
-    uint16_t currentADC[16];
-    #define ADC_CHANNEL_COUNT 16
-#endif
+static uint16_t adcBank[2][ADC_CHANNEL_COUNT];
+static volatile uint8_t adcBankVisible;
+static volatile uint16_t adcSequence;
+
+static uint32_t adcAccumulator[ADC_CHANNEL_COUNT];
+static uint8_t adcDecimationCounter;
+static uint8_t adcDecimationScans;
+static uint8_t adcDecimationShift;
+
+/*
+    Scan table
+
+        Instead of a fixed round robin over all inputs the ISR walks through
+        adcScanTable. Every entry contains the channel number (lower nibble)
+        and the ADC_SCANTABLE_LAST flag that marks the last occurrence of this
+        channel in the table (publishing happens there). The table is built
+        from per channel weights (0, 1, 2 or 4 occurrences per pass) with the
+        occurrences spread evenly over the pass.
+
+        Since the ADC runs in free running mode the conversion after the one
+        that just finished has already been started with the previous MUX
+        setting. adcScanRunning is the table index of that running conversion,
+        the ISR selects the channel for the one after it. After (re)starting
+        the scan the first finished conversions are discarded (adcScanDiscard)
+        since they do not belong to a table position. Channels with weight 0
+        are not sampled and keep their last published value.
+*/
+#define ADC_SCANTABLE_LAST 0x80
+
+static uint8_t adcScanTable[ADC_SCANTABLE_MAX];
+static uint8_t adcScanLength;
+static uint8_t adcScanRunning;
+static uint8_t adcScanDiscard;
+static uint8_t adcChannelLog2Weight[ADC_CHANNEL_COUNT];
+static uint8_t adcScanWeights[ADC_CHANNEL_COUNT];
+
+static struct adcStatistics adcStats[ADC_CHANNEL_COUNT];
+static uint16_t adcStatisticsWindow;
+
+/*
+    Overcurrent trip
+
+        ADC_TRIP_SAMPLES consecutive raw conversions above adcTripThreshold
+        of their channel disable all outputs directly from the ISR
+        (ADC_TRIP_DISABLED never trips since raw values are limited to 10
+        bits). The first trip is latched until it has been collected with
+        adcTripPoll by the main loop.
+*/
+static uint16_t adcTripThreshold[ADC_CHANNEL_COUNT];
+static uint8_t adcTripOverCount[ADC_CHANNEL_COUNT];
+static volatile bool adcTripPending;
+static struct adcTripStatus adcTripLast;
+
+/*
+    Calibration of PSU readouts in Q16 fixed point (k and d of the linear
+    model in cfgOptions.psuADCCalibration scaled by 2^16). They are only
+    recalculated when the calibration changes so converting a reading does
+    not require any floating point operation
+*/
+static struct adcCalibrationQ16 adcCalibration[ADC_CALIBRATION_CHANNELS];
+
+/*
+    Burst trace capture
+
+        While armed every conversion of a channel selected in
+        adcTraceChannelMask is written into the circular adcTraceBuffer
+        (raw value in the lower 10 bits, channel number in the upper
+        nibble). As soon as a trigger arrives (threshold crossing inside
+        the ISR or adcTraceTrigger from the main loop) another
+        adcTracePost entries are recorded and the capture stops so the
+        buffer contains the history before and after the event.
+*/
+static uint16_t adcTraceBuffer[ADC_TRACE_LENGTH];
+static uint16_t adcTraceHead;
+static uint16_t adcTraceCount;
+static uint16_t adcTracePost;
+static uint16_t adcTraceRemaining;
+static uint16_t adcTraceChannelMask;
+static uint8_t adcTraceThresholdChannel;
+static uint16_t adcTraceThreshold;
+static bool adcTraceThresholdFalling;
+static volatile uint8_t adcTraceState;
+static volatile uint8_t adcTraceSource;
 
 /*@
-    assigns currentADC[0 .. ADC_CHANNEL_COUNT-1];
+    assigns adcTraceState;
+    assigns adcTraceSource;
+    assigns adcTraceRemaining;
+*/
+static inline void adcTraceTriggerLocked(uint8_t source) {
+    if(adcTraceState != ADC_TRACE_STATE_ARMED) {
+        return;
+    }
+    adcTraceSource = source;
+    adcTraceRemaining = adcTracePost;
+    adcTraceState = (adcTracePost == 0) ? ADC_TRACE_STATE_DONE : ADC_TRACE_STATE_TRIGGERED;
+}
+
+/*@
+    requires (channel >= 0) && (channel < ADC_CHANNEL_COUNT);
+
+    assigns adcTraceBuffer[0 .. ADC_TRACE_LENGTH-1];
+    assigns adcTraceHead;
+    assigns adcTraceCount;
+    assigns adcTraceRemaining;
+    assigns adcTraceState;
+    assigns adcTraceSource;
+*/
+static inline void adcTraceSample(uint8_t channel, uint16_t raw) {
+    if(((adcTraceChannelMask >> channel) & 0x01) == 0) {
+        return;
+    }
+
+    adcTraceBuffer[adcTraceHead] = (((uint16_t)channel) << 12) | raw;
+    adcTraceHead = (adcTraceHead + 1) & (ADC_TRACE_LENGTH - 1);
+    if(adcTraceCount < ADC_TRACE_LENGTH) {
+        adcTraceCount = adcTraceCount + 1;
+    }
+
+    if(adcTraceState == ADC_TRACE_STATE_ARMED) {
+        if(channel == adcTraceThresholdChannel) {
+            if(((adcTraceThresholdFalling == false) && (raw >= adcTraceThreshold)) || ((adcTraceThresholdFalling != false) && (raw <= adcTraceThreshold))) {
+                adcTraceTriggerLocked(ADC_TRACE_SOURCE_THRESHOLD);
+            }
+        }
+    } else {
+        adcTraceRemaining = adcTraceRemaining - 1;
+        if(adcTraceRemaining == 0) {
+            adcTraceState = ADC_TRACE_STATE_DONE;
+        }
+    }
+}
+
+/*@
+    requires (channel >= 0) && (channel < ADC_CHANNEL_COUNT);
+
+    assigns adcTripPending;
+    assigns adcTripLast;
+    assigns pwmoutOnCycles[0 .. 7];
+    assigns PORTL;
+    assigns PORTA;
+    assigns PORTC;
+*/
+static void adcTripFire(uint8_t channel, uint16_t raw) {
+    unsigned long int tDetect;
+    uint16_t response;
+
+    if(adcTripPending == true) {
+        return; /* Outputs are already off, keep the record of the first trip till collected */
+    }
+
+    tDetect = micros();
+    pwmoutEmergencyOff();
+    psuEmergencyDisable();
+
+    /*
+        Response time of the trip: conversion time of the tripping sample
+        plus the time we needed inside the ISR till all outputs are off.
+        There is no timestamp of the conversion end so the delay till the
+        ISR has been entered is not included (it is bounded by the longest
+        other ISR, see isrstats)
+    */
+    response = ADC_CONVERSION_MICROS + (uint16_t)(micros() - tDetect);
+
+    adcTripLast.channel = channel;
+    adcTripLast.raw = raw;
+    adcTripLast.responseMicros = response;
+    if(response > adcTripLast.maxResponseMicros) {
+        adcTripLast.maxResponseMicros = response;
+    }
+    adcTripLast.tripCount = adcTripLast.tripCount + 1;
+    adcTripPending = true;
+
+    adcTraceTriggerLocked(ADC_TRACE_SOURCE_OVERCURRENT);
+}
+
+/*@
+    requires (channel >= 0) && (channel < ADC_CHANNEL_COUNT);
+    assigns ADMUX;
+    assigns ADCSRB;
+*/
+static inline void adcSelectChannel(uint8_t channel) {
+    ADMUX = (channel & 0x07) | (ADMUX & 0xE0);
+    #ifdef ADC_CHANNELS16
+        ADCSRB = (ADCSRB & 0xF7) | (channel & 0x08);
+    #endif
+}
+
+/*@
+    assigns adcBank[0 .. 1][0 .. ADC_CHANNEL_COUNT-1];
+    assigns adcBankVisible;
+    assigns adcAccumulator[0 .. ADC_CHANNEL_COUNT-1];
+    assigns adcDecimationCounter;
+    assigns adcSequence;
+    assigns adcStats[0 .. ADC_CHANNEL_COUNT-1];
+    assigns adcScanRunning;
+    assigns adcScanDiscard;
+    assigns adcTraceBuffer[0 .. ADC_TRACE_LENGTH-1];
+    assigns adcTraceHead;
+    assigns adcTraceCount;
+    assigns adcTraceRemaining;
+    assigns adcTraceState;
+    assigns adcTraceSource;
+    assigns adcTripOverCount[0 .. ADC_CHANNEL_COUNT-1];
+    assigns adcTripPending;
+    assigns adcTripLast;
     assigns ADMUX;
     assigns ADCSRB;
 */
+static inline void adcHandleConversion() {
+    uint8_t adcIndex;
+    uint8_t entry;
+    uint8_t completedPos;
+    uint16_t raw;
+    struct adcStatistics* lpStat;
+
+    raw = ADC;
+
+    if(adcScanDiscard != 0) {
+        /*
+            Conversions after a (re)start do not belong to a table position.
+            We discard two of them so the MUX change has been picked up by
+            the running conversion even if it raced with the restart
+        */
+        adcScanDiscard = adcScanDiscard - 1;
+        if(adcScanDiscard == 0) {
+            adcScanRunning = 0;
+            adcSelectChannel(adcScanTable[(adcScanLength > 1) ? 1 : 0] & 0x0F);
+        } else {
+            adcSelectChannel(adcScanTable[0] & 0x0F);
+        }
+        return;
+    }
+
+    completedPos = adcScanRunning;
+    adcScanRunning = ((adcScanRunning + 1) < adcScanLength) ? (adcScanRunning + 1) : 0;
+    adcSelectChannel(adcScanTable[((adcScanRunning + 1) < adcScanLength) ? (adcScanRunning + 1) : 0] & 0x0F);
+
+    entry = adcScanTable[completedPos];
+    adcIndex = entry & 0x0F;
+
+    if(raw > adcTripThreshold[adcIndex]) {
+        if(adcTripOverCount[adcIndex] < ADC_TRIP_SAMPLES) {
+            adcTripOverCount[adcIndex] = adcTripOverCount[adcIndex] + 1;
+        }
+        if(adcTripOverCount[adcIndex] >= ADC_TRIP_SAMPLES) {
+            adcTripFire(adcIndex, raw);
+        }
+    } else {
+        adcTripOverCount[adcIndex] = 0;
+    }
+
+    if((adcTraceState == ADC_TRACE_STATE_ARMED) || (adcTraceState == ADC_TRACE_STATE_TRIGGERED)) {
+        adcTraceSample(adcIndex, raw);
+    }
+
+    lpStat = &(adcStats[adcIndex]);
+    if((lpStat->count == 0) || (lpStat->count == adcStatisticsWindow)) {
+        lpStat->min = raw;
+        lpStat->max = raw;
+        lpStat->sum = raw;
+        lpStat->count = 1;
+    } else {
+        if(raw < lpStat->min) { lpStat->min = raw; }
+        if(raw > lpStat->max) { lpStat->max = raw; }
+        if(lpStat->count != 0xFFFF) {
+            /* Without window count saturates, min and max keep tracking */
+            lpStat->sum = lpStat->sum + raw;
+            lpStat->count = lpStat->count + 1;
+        }
+    }
+
+    adcAccumulator[adcIndex] = adcAccumulator[adcIndex] + raw;
+
+    if((adcDecimationCounter == (adcDecimationScans - 1)) && ((entry & ADC_SCANTABLE_LAST) != 0)) {
+        /* Last occurrence in the last pass of the current block: publish and restart accumulation */
+        adcBank[adcBankVisible ^ 0x01][adcIndex] = (uint16_t)((adcAccumulator[adcIndex] << (ADC_OVERSAMPLED_BITS - 10)) >> (adcDecimationShift + adcChannelLog2Weight[adcIndex]));
+        adcAccumulator[adcIndex] = 0;
+    }
+
+    if(completedPos == (adcScanLength - 1)) {
+        if(adcDecimationCounter == (adcDecimationScans - 1)) {
+            adcDecimationCounter = 0;
+            adcBankVisible = adcBankVisible ^ 0x01;
+            adcSequence = adcSequence + 1;
+        } else {
+            adcDecimationCounter = adcDecimationCounter + 1;
+        }
+    }
+}
+
 ISR(ADC_vect) {
-    #ifndef ADC_CHANNELS16
-        uint8_t oldMUX = ADMUX;
+    SYSCLOCK_ISR_ENTER();
+    adcHandleConversion();
+    SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_ADC);
+}
+
+/*
+    Restarts accumulation from scratch (has to be called with interrupts
+    disabled whenever decimation or scan table change)
+*/
+static void adcRestartAccumulation() {
+    unsigned long int i;
+
+    adcDecimationCounter = 0;
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        adcAccumulator[i] = 0;
+    }
+}
+
+/*@
+    requires (decimation == 1) || (decimation == 4) || (decimation == 16) || (decimation == 64);
+
+    assigns adcDecimationScans;
+    assigns adcDecimationShift;
+    assigns adcDecimationCounter;
+    assigns adcAccumulator[0 .. ADC_CHANNEL_COUNT-1];
+*/
+bool adcSetDecimation(uint8_t decimation) {
+    uint8_t shift;
+    uint8_t oldSREG;
+
+    switch(decimation) {
+        case 1:     shift = 0; break;
+        case 4:     shift = 2; break;
+        case 16:    shift = 4; break;
+        case 64:    shift = 6; break;
+        default:    return false;
+    }
+
+    oldSREG = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    adcDecimationScans = decimation;
+    adcDecimationShift = shift;
+    adcRestartAccumulation();
+
+    SREG = oldSREG;
+
+    return true;
+}
+
+/*@
+    requires \valid(&(lpWeights[0 .. ADC_CHANNEL_COUNT-1]));
+
+    assigns adcScanTable[0 .. ADC_SCANTABLE_MAX-1];
+    assigns adcScanLength;
+    assigns adcScanRunning;
+    assigns adcScanDiscard;
+    assigns adcChannelLog2Weight[0 .. ADC_CHANNEL_COUNT-1];
+    assigns adcScanWeights[0 .. ADC_CHANNEL_COUNT-1];
+    assigns adcDecimationCounter;
+    assigns adcAccumulator[0 .. ADC_CHANNEL_COUNT-1];
+    assigns ADMUX;
+    assigns ADCSRB;
+*/
+bool adcSetScanWeights(uint8_t* lpWeights) {
+    uint8_t newTable[ADC_SCANTABLE_MAX];
+    uint8_t newLog2Weight[ADC_CHANNEL_COUNT];
+    uint8_t newLength = 0;
+    uint8_t maxWeight = 0;
+    uint8_t round;
+    unsigned long int i;
+    uint8_t oldSREG;
+
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        switch(lpWeights[i]) {
+            case 0:     newLog2Weight[i] = 0; break;
+            case 1:     newLog2Weight[i] = 0; break;
+            case 2:     newLog2Weight[i] = 1; break;
+            case 4:     newLog2Weight[i] = 2; break;
+            default:    return false;
+        }
+        if(lpWeights[i] > maxWeight) { maxWeight = lpWeights[i]; }
+    }
+    if(maxWeight == 0) {
+        return false; /* We require at least one channel */
+    }
+
+    /*
+        A channel with weight w is sampled in every (maxWeight/w)-th round
+        of a pass so its samples are spread evenly
+    */
+    for(round = 0; round < maxWeight; round=round+1) {
+        for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+            if((lpWeights[i] != 0) && ((round % (maxWeight / lpWeights[i])) == 0)) {
+                newTable[newLength] = i;
+                newLength = newLength + 1;
+            }
+        }
+    }
+
+    /* Mark last occurrence of every channel */
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        uint8_t j;
+        for(j = newLength; j > 0; j=j-1) {
+            if(newTable[j-1] == i) {
+                newTable[j-1] = newTable[j-1] | ADC_SCANTABLE_LAST;
+                break;
+            }
+        }
+    }
+
+    oldSREG = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    for(i = 0; i < newLength; i=i+1) {
+        adcScanTable[i] = newTable[i];
+    }
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        adcChannelLog2Weight[i] = newLog2Weight[i];
+        adcScanWeights[i] = lpWeights[i];
+    }
+    adcScanLength = newLength;
+    adcScanRunning = 0;
+    adcScanDiscard = 2;
+    adcSelectChannel(adcScanTable[0] & 0x0F);
+    adcRestartAccumulation();
+
+    SREG = oldSREG;
+
+    return true;
+}
+
+uint8_t adcGetDecimation() {
+    return adcDecimationScans;
+}
+
+/*@
+    requires \valid(&(lpOut[0 .. ADC_CHANNEL_COUNT-1]));
+    assigns lpOut[0 .. ADC_CHANNEL_COUNT-1];
+*/
+void adcGetScanWeights(uint8_t* lpOut) {
+    unsigned long int i;
+
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        lpOut[i] = adcScanWeights[i];
+    }
+}
+
+/*@
+    assigns \nothing;
+*/
+uint16_t adcGetSequence() {
+    uint16_t seq;
+    uint8_t oldSREG = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    seq = adcSequence;
+    SREG = oldSREG;
+
+    return seq;
+}
+
+/*@
+    requires \valid(lpOut);
+
+    assigns lpOut->sequence;
+    assigns lpOut->values[0 .. ADC_CHANNEL_COUNT-1];
+*/
+void adcGetSnapshot(struct adcSnapshot* lpOut) {
+    unsigned long int i;
+    uint8_t bank;
+    uint16_t seqAfter;
+    uint8_t oldSREG;
+
+    /*@
+        loop assigns lpOut->sequence;
+        loop assigns lpOut->values[0 .. ADC_CHANNEL_COUNT-1];
+    */
+    for(;;) {
+        oldSREG = SREG;
+        #ifndef FRAMAC_SKIP
+            cli();
+        #endif
+        bank = adcBankVisible;
+        lpOut->sequence = adcSequence;
+        SREG = oldSREG;
 
-        currentADC[(oldMUX + 7) & 0x07] = ADC;
+        for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+            lpOut->values[i] = adcBank[bank][i];
+        }
 
-        ADMUX = (((oldMUX & 0x1F) + 1) & 0x07) | (oldMUX & 0xE0);
-    #else
-        uint8_t oldMUX = ADMUX;
-        uint8_t oldADCSRB = ADCSRB;
+        oldSREG = SREG;
+        #ifndef FRAMAC_SKIP
+            cli();
+        #endif
+        seqAfter = adcSequence;
+        SREG = oldSREG;
 
-        uint8_t adcIndex = (((oldMUX & 0x07) | (oldADCSRB & 0x08)) + 15) & 0x0F;
+        if(seqAfter == lpOut->sequence) {
+            return;
+        }
+    }
+}
 
-        currentADC[adcIndex] = ADC;
+/*@
+    requires \valid(&(lpOut[0 .. ADC_CHANNEL_COUNT-1]));
+
+    assigns lpOut[0 .. ADC_CHANNEL_COUNT-1];
+    assigns adcStats[0 .. ADC_CHANNEL_COUNT-1].count;
+*/
+void adcStatisticsFetch(struct adcStatistics* lpOut) {
+    unsigned long int i;
+    uint8_t oldSREG = SREG;
 
-        ADMUX = ((adcIndex + 2) & 0x07) | (oldMUX & 0xE0);
-        ADCSRB = (oldADCSRB & 0xF7) | ((adcIndex + 2) & 0x08);
+    #ifndef FRAMAC_SKIP
+        cli();
     #endif
+
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        lpOut[i] = adcStats[i];
+        adcStats[i].count = 0;
+    }
+
+    SREG = oldSREG;
+}
+
+void adcStatisticsSetWindow(uint16_t window) {
+    unsigned long int i;
+    uint8_t oldSREG = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    adcStatisticsWindow = window;
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        adcStats[i].count = 0;
+    }
+    SREG = oldSREG;
+}
+
+uint16_t adcStatisticsGetWindow() {
+    return adcStatisticsWindow;
+}
+
+/*@
+    requires preTrigger <= ADC_TRACE_LENGTH;
+
+    assigns adcTraceHead;
+    assigns adcTraceCount;
+    assigns adcTracePost;
+    assigns adcTraceRemaining;
+    assigns adcTraceChannelMask;
+    assigns adcTraceThresholdChannel;
+    assigns adcTraceThreshold;
+    assigns adcTraceThresholdFalling;
+    assigns adcTraceState;
+    assigns adcTraceSource;
+*/
+bool adcTraceArm(
+    uint16_t channelMask,
+    uint16_t preTrigger,
+    uint8_t thresholdChannel,
+    uint16_t threshold,
+    bool bFalling
+) {
+    uint8_t oldSREG;
+
+    if((channelMask == 0) || (preTrigger > ADC_TRACE_LENGTH)) {
+        return false;
+    }
+    if((thresholdChannel != ADC_TRACE_THRESHOLD_DISABLED) && ((thresholdChannel >= ADC_CHANNEL_COUNT) || (threshold > 1023))) {
+        return false;
+    }
+
+    oldSREG = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    adcTraceHead = 0;
+    adcTraceCount = 0;
+    adcTracePost = ADC_TRACE_LENGTH - preTrigger;
+    adcTraceRemaining = 0;
+    adcTraceChannelMask = channelMask;
+    adcTraceThresholdChannel = thresholdChannel;
+    adcTraceThreshold = threshold;
+    adcTraceThresholdFalling = bFalling;
+    adcTraceSource = ADC_TRACE_SOURCE_NONE;
+    adcTraceState = ADC_TRACE_STATE_ARMED;
+
+    SREG = oldSREG;
+
+    return true;
+}
+
+/*@
+    assigns adcTraceState;
+*/
+void adcTraceStop() {
+    uint8_t oldSREG = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    if(adcTraceState != ADC_TRACE_STATE_DONE) {
+        adcTraceState = ADC_TRACE_STATE_IDLE;
+    }
+    SREG = oldSREG;
+}
+
+/*
+    External trigger (limit mode change, insulation failure, ...). Ignored
+    if the capture is not armed so it can be called unconditionally
+*/
+void adcTraceTrigger(uint8_t source) {
+    uint8_t oldSREG;
+
+    if(adcTraceState != ADC_TRACE_STATE_ARMED) {
+        return;
+    }
+
+    oldSREG = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    adcTraceTriggerLocked(source);
+    SREG = oldSREG;
+}
+
+/*@
+    requires \valid(lpOut);
+    assigns *lpOut;
+*/
+void adcTraceGetStatus(struct adcTraceStatus* lpOut) {
+    uint8_t oldSREG = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    lpOut->state = adcTraceState;
+    lpOut->source = adcTraceSource;
+    lpOut->count = adcTraceCount;
+    lpOut->triggerIndex = 0;
+    if(adcTraceSource != ADC_TRACE_SOURCE_NONE) {
+        /* Samples recorded after the trigger are the last (post - remaining) entries */
+        lpOut->triggerIndex = adcTraceCount - (adcTracePost - adcTraceRemaining);
+    }
+    SREG = oldSREG;
+}
+
+/*
+    Copies up to maxEntries trace entries starting at offset (0 is the
+    oldest recorded entry). Only possible while no capture is running,
+    returns the number of copied entries
+*/
+/*@
+    requires \valid(&(lpOut[0 .. maxEntries-1]));
+    assigns lpOut[0 .. maxEntries-1];
+*/
+uint16_t adcTraceRead(
+    uint16_t offset,
+    uint16_t* lpOut,
+    uint16_t maxEntries
+) {
+    uint16_t i;
+    uint16_t oldest;
+
+    if((adcTraceState == ADC_TRACE_STATE_ARMED) || (adcTraceState == ADC_TRACE_STATE_TRIGGERED)) {
+        return 0;
+    }
+    if(offset >= adcTraceCount) {
+        return 0;
+    }
+    if(maxEntries > (adcTraceCount - offset)) {
+        maxEntries = adcTraceCount - offset;
+    }
+
+    oldest = (adcTraceHead - adcTraceCount) & (ADC_TRACE_LENGTH - 1);
+    for(i = 0; i < maxEntries; i=i+1) {
+        lpOut[i] = adcTraceBuffer[(oldest + offset + i) & (ADC_TRACE_LENGTH - 1)];
+    }
+
+    return maxEntries;
+}
+
+/*@
+    assigns adcCalibration[0 .. ADC_CALIBRATION_CHANNELS-1];
+*/
+void adcCalibrationUpdate() {
+    unsigned long int i;
+
+    for(i = 0; i < ADC_CALIBRATION_CHANNELS; i=i+1) {
+        adcCalibrationQ16Set(&(adcCalibration[i]), cfgOptions.psuADCCalibration.channel[i].k, cfgOptions.psuADCCalibration.channel[i].d, ADC_OVERSAMPLED_BITS - 10);
+    }
+}
+
+/*@
+    requires (channel >= 0) && (channel < ADC_CALIBRATION_CHANNELS);
+    requires (adcCounts >= 0) && (adcCounts < (1 << ADC_OVERSAMPLED_BITS));
+    assigns \nothing;
+*/
+uint16_t adcCalibratedValue(
+    uint8_t channel,
+    uint16_t adcCounts
+) {
+    return adcCalibrationQ16Apply(&(adcCalibration[channel]), adcCounts);
+}
+
+/*
+    Inverse of adcCalibratedValue: smallest reading that is converted into
+    at least value (saturated to 0 ... 2^ADC_OVERSAMPLED_BITS - 1)
+*/
+/*@
+    requires (channel >= 0) && (channel < ADC_CALIBRATION_CHANNELS);
+    assigns \nothing;
+    ensures \result < (1 << ADC_OVERSAMPLED_BITS);
+*/
+uint16_t adcCalibratedInverse(
+    uint8_t channel,
+    uint16_t value
+) {
+    return adcCalibrationQ16Inverse(&(adcCalibration[channel]), value);
+}
+
+/*@
+    requires (channel >= 0) && (channel < ADC_CHANNEL_COUNT);
+    assigns adcTripThreshold[channel];
+    assigns adcTripOverCount[channel];
+*/
+void adcTripSetThreshold(
+    uint8_t channel,
+    uint16_t threshold
+) {
+    uint8_t oldSREG;
+
+    if(channel >= ADC_CHANNEL_COUNT) {
+        return;
+    }
+
+    oldSREG = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    adcTripThreshold[channel] = threshold;
+    adcTripOverCount[channel] = 0;
+    SREG = oldSREG;
+}
+
+/*
+    Returns true (and the trip record) exactly once for every latched trip
+*/
+/*@
+    requires \valid(lpOut);
+    assigns *lpOut;
+    assigns adcTripPending;
+*/
+bool adcTripPoll(struct adcTripStatus* lpOut) {
+    bool bTripped;
+    uint8_t oldSREG;
+
+    if(adcTripPending != true) {
+        return false;
+    }
+
+    oldSREG = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    *lpOut = adcTripLast;
+    bTripped = adcTripPending;
+    adcTripPending = false;
+    SREG = oldSREG;
+
+    return bTripped;
+}
+
+/*@
+    requires \valid(lpOut);
+    assigns *lpOut;
+*/
+void adcTripGetStatus(struct adcTripStatus* lpOut) {
+    uint8_t oldSREG = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    *lpOut = adcTripLast;
+    SREG = oldSREG;
+}
+
+/*
+    Time between two conversions of the same scan table entry, i.e. the
+    worst case time till a channel is sampled again
+*/
+uint16_t adcGetScanPeriodMicros() {
+    return ((uint16_t)adcScanLength) * ADC_CONVERSION_MICROS;
+}
+
+/*
+    Busy waits till at least one complete decimation block has been
+    published (bounded to 250 ms in case the ADC is not running)
+*/
+void adcWaitSettled() {
+    uint16_t seqStart = adcGetSequence();
+    unsigned long int i;
+
+    /*@
+        loop invariant 0 <= i <= 250;
+        loop variant 250 - i;
+    */
+    for(i = 0; i < 250; i=i+1) {
+        if(adcGetSequence() != seqStart) {
+            return;
+        }
+        delay(1);
+    }
 }
 
 /*@
@@ -58,8 +878,8 @@ ISR(ADC_vect) {
     assigns SREG;
 
     ensures (PRR0 & 0x01) == 0;
-    ensures (ADMUX == 0x40);
-    ensures (ADCSRB == 0x00);
+    ensures (ADMUX & 0xE0) == 0x40;
+    ensures (ADCSRB & 0xF7) == 0x00;
     ensures ADCSRA == 0xFF;
 */
 void adcInit() {
@@ -71,15 +891,42 @@ void adcInit() {
     #endif
 
     adcCurrentMux = 0;
+    adcSequence = 0;
+    adcTraceState = ADC_TRACE_STATE_IDLE;
+    adcTraceSource = ADC_TRACE_SOURCE_NONE;
+    adcTraceCount = 0;
+    adcBankVisible = 0;
 
-    for(i = 0; i < sizeof(currentADC) / sizeof(uint16_t); i=i+1) {
-        currentADC[i] = ~0;
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        adcBank[0][i] = ~0;
+        adcBank[1][i] = ~0;
+        adcStats[i].count = 0;
+        adcTripThreshold[i] = ADC_TRIP_DISABLED;
+        adcTripOverCount[i] = 0;
     }
+    adcTripPending = false;
+    adcStatisticsWindow = cfgOptions.adc.statisticsWindow;
+    adcCalibrationUpdate();
 
     PRR0 = PRR0 & ~(0x01); /* Disable power saving features for ADC */
     ADMUX = 0x40; /* AVCC reference voltage, MUX 0, right aligned */
     ADCSRB = 0x00; /* Free running trigger mode, highest mux bit 0 */
-    ADCSRA = 0xBF; /* Prescaler / 128 -> about 1 kHz measurement effective for all PSUs, interrupt enable; ADCs currently DISABLED */
+
+    if(adcSetDecimation(cfgOptions.adc.decimation) != true) {
+        adcSetDecimation(ADC_DECIMATION_DEFAULT);
+    }
+    if(adcSetScanWeights(cfgOptions.adc.scanWeights) != true) {
+        uint8_t defaultWeights[ADC_CHANNEL_COUNT];
+        for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+            defaultWeights[i] = 0;
+        }
+        for(i = 0; i < PSU_COUNT; i=i+1) {
+            defaultWeights[psuDescriptors[i].adcVoltage] = 1;
+            defaultWeights[psuDescriptors[i].adcCurrent] = 1;
+        }
+        adcSetScanWeights(defaultWeights);
+    }
+    ADCSRA = 0xBF; /* Prescaler / 128 -> about 9.6 kHz conversions shared by all scan table entries, interrupt enable; ADCs currently DISABLED */
 
     SREG = oldSREG;
 
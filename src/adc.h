@@ -4,19 +4,202 @@
 /* We require 16 channels since we also want to measure current */
 #define ADC_CHANNELS16 1
 
-#ifdef __cplusplus
-    extern "C" {
-#endif
-
 #ifndef ADC_CHANNELS16
-    extern uint16_t currentADC[8];
+    #define ADC_CHANNEL_COUNT 8
 #else
-    extern uint16_t currentADC[16];
+    #define ADC_CHANNEL_COUNT 16
+#endif
+
+/*
+    Oversampling: Published values are always normalized to this resolution,
+    independent of the selected decimation (1, 4, 16 or 64 conversions per
+    published value yield 10, 11, 12 or 13 bits of effective resolution)
+*/
+#define ADC_OVERSAMPLED_BITS 13
+
+#ifndef ADC_DECIMATION_DEFAULT
+    #define ADC_DECIMATION_DEFAULT 16
+#endif
+
+/*
+    Scan table: Every channel gets a weight of 0 (not sampled), 1, 2 or 4
+    conversions per pass through the table
+*/
+#define ADC_SCANWEIGHT_MAX 4
+#define ADC_SCANTABLE_MAX (ADC_CHANNEL_COUNT * ADC_SCANWEIGHT_MAX)
+
+/*
+    Burst trace capture: Circular buffer of raw conversions (has to be a
+    power of two). Each entry contains the channel number in the upper
+    nibble and the raw 10 bit conversion result in the lower bits
+*/
+#ifndef ADC_TRACE_LENGTH
+    #define ADC_TRACE_LENGTH 512
+#endif
+
+#define ADC_TRACE_STATE_IDLE            0
+#define ADC_TRACE_STATE_ARMED           1
+#define ADC_TRACE_STATE_TRIGGERED       2
+#define ADC_TRACE_STATE_DONE            3
+
+#define ADC_TRACE_SOURCE_NONE           0
+#define ADC_TRACE_SOURCE_THRESHOLD      1
+#define ADC_TRACE_SOURCE_LIMITMODE      2
+#define ADC_TRACE_SOURCE_INSULATION     3
+#define ADC_TRACE_SOURCE_MANUAL         4
+#define ADC_TRACE_SOURCE_OVERCURRENT    5
+
+#define ADC_TRACE_THRESHOLD_DISABLED    0xFF
+
+/*
+    Duration of a single conversion in free running mode (13 ADC clocks at
+    prescaler 128)
+*/
+#define ADC_CONVERSION_MICROS ((uint16_t)((13L * 128L * 1000000L) / F_CPU))
+
+/*
+    Overcurrent trip threshold that never fires
+*/
+#define ADC_TRIP_DISABLED 0xFFFF
+
+/*
+    Consecutive raw conversions of a channel above its threshold required
+    to trip, so a single disturbed conversion does not shut down the beam
+*/
+#ifndef ADC_TRIP_SAMPLES
+    #define ADC_TRIP_SAMPLES 2
+#endif
+
+/*
+    Number of linear calibrations in cfgOptions.psuADCCalibration
+    (voltage and current for every PSU, see psu.h)
+*/
+#define ADC_CALIBRATION_CHANNELS PSU_CHANNELS
+
+#ifndef __cplusplus
+    #ifndef true
+        #define true 1
+        #define false 0
+        typedef unsigned char bool;
+    #endif
 #endif
 
+/*
+    Running statistics of raw conversions per channel. They cover all
+    samples since the last fetch or - if a window is configured - at
+    most the last window started (the statistics restart automatically
+    after window samples). Without window count (and sum) stop at 65535
+    samples while min and max keep covering everything till the fetch
+*/
+struct adcStatistics {
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+    uint16_t count;
+};
+
+/*
+    Consistent copy of one complete published block of all channels
+    (values normalized to ADC_OVERSAMPLED_BITS)
+*/
+struct adcSnapshot {
+    uint16_t sequence;
+    uint16_t values[ADC_CHANNEL_COUNT];
+};
+
+struct adcTraceStatus {
+    uint8_t state;
+    uint8_t source;
+    uint16_t count;             /* Number of valid entries */
+    uint16_t triggerIndex;      /* Offset of the first entry after the trigger */
+};
+
+struct adcTripStatus {
+    uint8_t channel;            /* ADC channel that tripped */
+    uint16_t raw;               /* Raw conversion result that tripped */
+    uint16_t responseMicros;    /* Conversion and ISR handling till outputs off */
+    uint16_t maxResponseMicros; /* Worst case since power on */
+    uint16_t tripCount;
+};
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
 
 void adcInit();
 
+/*
+    Selects the number of conversions accumulated per published value.
+    Only 1, 4, 16 and 64 are accepted (returns false otherwise)
+*/
+bool adcSetDecimation(uint8_t decimation);
+uint8_t adcGetDecimation();
+
+/*
+    Rebuilds the scan table from ADC_CHANNEL_COUNT weights (0, 1, 2 or 4).
+    Returns false (and keeps the current table) for invalid weights or if
+    no channel would be sampled at all
+*/
+bool adcSetScanWeights(uint8_t* lpWeights);
+void adcGetScanWeights(uint8_t* lpOut);
+
+/*
+    Sequence number of the last completely published decimation block
+    and a consistent copy of all channels of that block
+*/
+uint16_t adcGetSequence();
+void adcGetSnapshot(struct adcSnapshot* lpOut);
+
+void adcWaitSettled();
+
+/*
+    Recalculates the fixed point calibration from cfgOptions.psuADCCalibration.
+    Has to be called whenever the calibration has been changed or loaded
+*/
+void adcCalibrationUpdate();
+
+/*
+    Applies the linear calibration of calibration channel (2*PSU for voltage,
+    2*PSU+1 for current) to a reading normalized to ADC_OVERSAMPLED_BITS
+    (k of cfgOptions.psuADCCalibration stays per 10 bit count). Results are
+    saturated to 0 ... 65535. adcCalibratedInverse returns the smallest
+    such reading that is converted into at least value
+*/
+uint16_t adcCalibratedValue(uint8_t channel, uint16_t adcCounts);
+uint16_t adcCalibratedInverse(uint8_t channel, uint16_t value);
+
+/*
+    Overcurrent trip evaluated inside the ADC ISR. ADC_TRIP_SAMPLES
+    consecutive raw conversions of channel above threshold immediately
+    zero all PWM setpoints and clear all PSU enable outputs. adcTripPoll
+    returns true once for every latched trip so the main loop can perform
+    the regular error handling
+*/
+void adcTripSetThreshold(uint8_t channel, uint16_t threshold);
+bool adcTripPoll(struct adcTripStatus* lpOut);
+void adcTripGetStatus(struct adcTripStatus* lpOut);
+uint16_t adcGetScanPeriodMicros();
+
+/*
+    Copies the statistics of all channels into lpOut (ADC_CHANNEL_COUNT
+    entries) and restarts them within the same critical section
+*/
+void adcStatisticsFetch(struct adcStatistics* lpOut);
+void adcStatisticsSetWindow(uint16_t window);
+uint16_t adcStatisticsGetWindow();
+
+/*
+    Arms the burst trace for all channels in channelMask, keeping
+    preTrigger entries of history. If thresholdChannel is not
+    ADC_TRACE_THRESHOLD_DISABLED the ISR triggers as soon as a raw value
+    of that channel reaches threshold (or falls to threshold if bFalling)
+*/
+bool adcTraceArm(uint16_t channelMask, uint16_t preTrigger, uint8_t thresholdChannel, uint16_t threshold, bool bFalling);
+void adcTraceStop();
+void adcTraceTrigger(uint8_t source);
+void adcTraceGetStatus(struct adcTraceStatus* lpOut);
+uint16_t adcTraceRead(uint16_t offset, uint16_t* lpOut, uint16_t maxEntries);
+
 #ifdef __cplusplus
     } /* extern "C" { */
 #endif
@@ -0,0 +1,114 @@
+#include <stdint.h>
+
+#include "./adccal.h"
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+/*@
+    requires \valid(lpCal);
+    requires (fractionBits >= 0) && (fractionBits <= 6);
+    assigns *lpCal;
+*/
+void adcCalibrationQ16Set(
+    struct adcCalibrationQ16* lpCal,
+    double k,
+    double d,
+    uint8_t fractionBits
+) {
+    double kScaled = k * (double)(((uint32_t)1) << (16 - fractionBits));
+
+    lpCal->countMax = (uint16_t)((((uint32_t)1024) << fractionBits) - 1);
+
+    /* Saturate so countMax * k never overflows 32 bits */
+    if(kScaled <= 0) {
+        lpCal->k = 0;
+    } else if(kScaled >= (double)(UINT32_MAX / lpCal->countMax)) {
+        lpCal->k = UINT32_MAX / lpCal->countMax;
+    } else {
+        lpCal->k = (uint32_t)(kScaled + 0.5);
+    }
+
+    if(d >= 32767.0) {
+        lpCal->d = ((int32_t)32767) << 16;
+    } else if(d <= -32767.0) {
+        lpCal->d = -(((int32_t)32767) << 16);
+    } else if(d < 0) {
+        lpCal->d = -((int32_t)(-d * 65536.0 + 0.5));
+    } else {
+        lpCal->d = (int32_t)(d * 65536.0 + 0.5);
+    }
+}
+
+/*@
+    requires \valid_read(lpCal);
+    requires (adcCounts >= 0) && (adcCounts <= lpCal->countMax);
+    assigns \nothing;
+*/
+uint16_t adcCalibrationQ16Apply(
+    const struct adcCalibrationQ16* lpCal,
+    uint16_t adcCounts
+) {
+    uint32_t value;
+    int32_t d = lpCal->d;
+
+    value = ((uint32_t)adcCounts) * lpCal->k;
+    if(d < 0) {
+        if(value < (uint32_t)(-d)) {
+            return 0;
+        }
+        value = value - (uint32_t)(-d);
+    } else {
+        if(value > (UINT32_MAX - (uint32_t)d)) {
+            return 0xFFFF;
+        }
+        value = value + (uint32_t)d;
+    }
+
+    return (uint16_t)(value >> 16);
+}
+
+/*@
+    requires \valid_read(lpCal);
+    assigns \nothing;
+    ensures \result <= lpCal->countMax;
+*/
+uint16_t adcCalibrationQ16Inverse(
+    const struct adcCalibrationQ16* lpCal,
+    uint16_t value
+) {
+    uint32_t scaled = ((uint32_t)value) << 16;
+    int32_t d = lpCal->d;
+    uint32_t counts;
+
+    if(value == 0) {
+        return 0; /* Every reading saturates to at least 0 */
+    }
+    if(lpCal->k == 0) {
+        return lpCal->countMax;
+    }
+
+    if(d < 0) {
+        if(scaled > (UINT32_MAX - (uint32_t)(-d))) {
+            return lpCal->countMax;
+        }
+        scaled = scaled + (uint32_t)(-d);
+    } else {
+        if(scaled < (uint32_t)d) {
+            return 0;
+        }
+        scaled = scaled - (uint32_t)d;
+    }
+
+    /* Round up without adding k - 1 first, scaled may be close to 2^32 */
+    counts = scaled / lpCal->k;
+    if((scaled % lpCal->k) != 0) {
+        counts = counts + 1;
+    }
+    return (counts > lpCal->countMax) ? lpCal->countMax : (uint16_t)counts;
+}
+
+#ifdef __cplusplus
+    } /* extern "C" { */
+#endif
@@ -0,0 +1,68 @@
+#ifndef __is_included__5d0c7a3e_7b2f_11f1_9a41_b499badf00a1
+#define __is_included__5d0c7a3e_7b2f_11f1_9a41_b499badf00a1 1
+
+/*
+    Q16 fixed point calibration arithmetic
+
+        Linear calibration (value = k * counts + d) of readings with k and
+        d scaled by 2^16. k is given per 10 bit ADC count, readings may
+        carry additional fraction bits from oversampling (so they range
+        from 0 to countMax = 2^(10 + fractionBits) - 1) and k is stored per
+        reading count. Does not touch any hardware so it can be built with
+        the host compiler (see test/ and "make test").
+
+        k is saturated so countMax * k fits into 32 bits, d to +-32767.
+        Applying a calibration floors the result and saturates it to
+        0 ... 65535.
+*/
+struct adcCalibrationQ16 {
+    uint32_t k;
+    int32_t d;
+    uint16_t countMax;
+};
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+/*@
+    requires \valid(lpCal);
+    requires (fractionBits >= 0) && (fractionBits <= 6);
+    assigns *lpCal;
+*/
+void adcCalibrationQ16Set(
+    struct adcCalibrationQ16* lpCal,
+    double k,
+    double d,
+    uint8_t fractionBits
+);
+
+/*@
+    requires \valid_read(lpCal);
+    requires (adcCounts >= 0) && (adcCounts <= lpCal->countMax);
+    assigns \nothing;
+*/
+uint16_t adcCalibrationQ16Apply(
+    const struct adcCalibrationQ16* lpCal,
+    uint16_t adcCounts
+);
+
+/*
+    Smallest reading that is converted into at least value (saturated to
+    0 ... countMax)
+*/
+/*@
+    requires \valid_read(lpCal);
+    assigns \nothing;
+    ensures \result <= lpCal->countMax;
+*/
+uint16_t adcCalibrationQ16Inverse(
+    const struct adcCalibrationQ16* lpCal,
+    uint16_t value
+);
+
+#ifdef __cplusplus
+    } /* extern "C" { */
+#endif
+
+#endif /* #ifndef __is_included__5d0c7a3e_7b2f_11f1_9a41_b499badf00a1 */
@@ -4,7 +4,9 @@
 #include <stdint.h>
 
 #include "./controller.h"
+#include "./psu.h"
 #include "./cfgeeprom.h"
+#include "./pwmout.h"
 
 #ifdef __cplusplus
 	extern "C" {
@@ -16,6 +18,7 @@ struct cfgOptions cfgOptions;
 struct cfgOptions cfgOptions_Default = {
 	0x00,	/* Checksum */
 	0xAA55, /* Magic value */
+	sizeof(struct cfgOptions), /* Layout size */
 	{ /* Target voltages for beam on and insulation test */
 		2000,	/* Cathode */
 		2020,	/* Whenelt */
@@ -33,13 +36,44 @@ struct cfgOptions cfgOptions_Default = {
 		250000 /* Filament step duration */
 	},
 	{
-		/* PSU readout defaults */
-		{
-			{ 3.221407, 0.0 }, { 9.765625 },
-			{ 3.221407, 0.0 }, { 9.765625 },
-			{ 3.221407, 0.0 }, { 9.765625 },
-			{ 3.221407, 0.0 }, { 9.765625 }
-		}
+		/* PSU readout defaults (nominal k from psuDescriptors, see cfgeepromDefaults) */
+		{ { 0.0, 0.0 } }
+	},
+	{
+		/* ADC acquisition */
+		16, /* Decimation */
+		0, /* Statistics window (until fetched) */
+		{ 0 } /* Scan weights: PSU voltages and currents only, see cfgeepromDefaults */
+	},
+	{
+		/* PSU readout filter */
+		{ 0 }, /* No filter */
+		{ 0 } /* EMA shift, see cfgeepromDefaults */
+	},
+	{
+		/* PWM outputs */
+		{ 0 }, /* Plain PWM on all channels */
+		{ 0 }, /* Slope limit on voltages only, see cfgeepromDefaults */
+		0, /* 10 bit PWM profile */
+		{ 0 }, /* Nominal scales from psuDescriptors, see cfgeepromDefaults */
+		{ 0 } /* No piecewise linear tables */
+	},
+	{
+		/* Closed loop voltage trim */
+		0x00, /* Disabled */
+		{ 0 }, /* Gain (1/8 on cycle per volt), see cfgeepromDefaults */
+		{ 0 } /* Clamp (about 100 V), see cfgeepromDefaults */
+	},
+	{
+		/* Blanking */
+		0 /* External trigger disabled */
+	},
+	{
+		/* Protection policy */
+		{ 0 }, /* Debounced current limit, see cfgeepromDefaults */
+		{ 0 }, /* No time qualification */
+		{ 0 }, /* No measured current threshold */
+		{ 0 } /* No arc counting */
 	}
 };
 
@@ -48,6 +82,23 @@ void cfgeepromDefaults() {
 	for(i = 0; i < sizeof(struct cfgOptions); i=i+1) {
 		((uint8_t*)(&cfgOptions))[i] = ((uint8_t*)(&cfgOptions_Default))[i];
 	}
+
+	/* Nominal readout and setpoint transfer and the other per PSU defaults */
+	for(i = 0; i < PSU_COUNT; i=i+1) {
+		cfgOptions.psuADCCalibration.channel[(i << 1)].k = psuDescriptors[i].adcVoltsPerCount;
+		cfgOptions.psuADCCalibration.channel[(i << 1) + 1].k = psuDescriptors[i].adcTenthMicroampsPerCount;
+		cfgOptions.pwmout.scale[psuDescriptors[i].pwmVoltage] = PWMOUT_SCALE_Q16(psuDescriptors[i].pwmVoltsPerOnCycle);
+		cfgOptions.pwmout.scale[psuDescriptors[i].pwmCurrent] = PWMOUT_SCALE_Q16(psuDescriptors[i].pwmMicroampsPerOnCycle);
+
+		cfgOptions.adc.scanWeights[psuDescriptors[i].adcVoltage] = 1;
+		cfgOptions.adc.scanWeights[psuDescriptors[i].adcCurrent] = 1;
+		cfgOptions.psuFilter.emaShift[(i << 1)] = 2;
+		cfgOptions.psuFilter.emaShift[(i << 1) + 1] = 2;
+		cfgOptions.pwmout.slope[psuDescriptors[i].pwmVoltage] = PWMOUT_SLOPE_DEFAULT;
+		cfgOptions.voltageTrim.gain[i] = PWMOUT_TRIM_GAIN_DEFAULT;
+		cfgOptions.voltageTrim.clamp[i] = PWMOUT_TRIM_CLAMP_DEFAULT;
+		cfgOptions.protection.ccSamples[i] = CONTROLLER_PROTECTION_CCSAMPLES_DEFAULT;
+	}
 	cfgeepromStore();
 }
 
@@ -60,7 +111,11 @@ void cfgeepromLoad() {
 	for(i = 0; i < sizeof(struct cfgOptions); i=i+1) {
 		chkSum = chkSum ^ ((uint8_t*)(&cfgOptions))[i];
 	}
-	if((chkSum != 0x00) || (cfgOptions.magic != 0xAA55)) {
+	/*
+		The XOR checksum does not detect a layout that grew by an even
+		number of erased (0xFF) bytes, so the stored size has to match too
+	*/
+	if((chkSum != 0x00) || (cfgOptions.magic != 0xAA55) || (cfgOptions.size != sizeof(struct cfgOptions))) {
 		cfgeepromDefaults();
 	}
 }
@@ -1,15 +1,21 @@
 #ifndef __is_included__b4fb2fa4_6f1b_11ed_b682_b499badf00a1
 #define __is_included__b4fb2fa4_6f1b_11ed_b682_b499badf00a1 1
 
+/* Array sizes depend on PSU_COUNT (and PWMOUT_CHANNELS derived from it) */
+#include "./psu.h"
+#include "./pwmout.h"
+
 #ifdef __cplusplus
 	extern "C" {
 #endif
 
 #define EEPROM_OFFSET_CFG 0
 
+
 struct cfgOptions {
 	uint8_t chksum;
 	uint16_t magic;
+	uint16_t size;		/* sizeof(struct cfgOptions): a changed layout loads the defaults */
 
 	struct {
 		unsigned long int cathode;
@@ -46,12 +52,50 @@ struct cfgOptions {
 			double k;
 			double d;
 
-			/* Calibration values */
+			/* Calibration values (readings at ADC_OVERSAMPLED_BITS) */
 			uint16_t adc0;
 			uint16_t adc1;
 			uint16_t vhigh;
-		} channel[8];
+		} channel[PSU_CHANNELS];
 	} psuADCCalibration;
+
+	struct {
+		uint8_t decimation;		/* Conversions per published value (1, 4, 16, 64) */
+		uint16_t statisticsWindow;	/* Samples per statistics window (0: until fetched) */
+		uint8_t scanWeights[16];	/* Conversions per scan table pass for each MUX channel (0, 1, 2, 4) */
+	} adc;
+
+	struct {
+		uint8_t mode[PSU_CHANNELS];	/* Filter of PSU readouts (2*PSU: voltage, 2*PSU+1: current) */
+		uint8_t emaShift[PSU_CHANNELS];	/* EMA alpha = 2^-emaShift */
+	} psuFilter;
+
+	struct {
+		uint8_t mode[PWMOUT_CHANNELS];	/* Output mode of each PWM channel (0: PWM, 1: sigma-delta) */
+		uint16_t slope[PWMOUT_CHANNELS];	/* Maximum change of on cycles per slope update (0: unlimited) */
+		uint8_t profile;		/* PWM profile (resolution and tick rate) */
+		uint32_t scale[PWMOUT_CHANNELS];	/* On cycles per volt or microamp (Q16) */
+		uint8_t pwlCount[PWMOUT_CHANNELS];	/* Active points of the piecewise linear table (< 2: use scale) */
+		uint16_t pwlValue[PWMOUT_CHANNELS][6];	/* Table: volts or microamps (strictly increasing) */
+		uint16_t pwlOnCycles[PWMOUT_CHANNELS][6];	/* Table: on cycles in 1/64 */
+	} pwmout;
+
+	struct {
+		uint8_t enable;			/* Bit n enables the closed loop trim of PSU n+1 */
+		uint16_t gain[PSU_COUNT];	/* Integral gain in 1/256 on cycles per volt error and step */
+		uint16_t clamp[PSU_COUNT];	/* Maximum trim in on cycles */
+	} voltageTrim;
+
+	struct {
+		uint8_t trigger;		/* External blanking input PK1 (0: off, 1: high blanks, 2: low blanks) */
+	} blanking;
+
+	struct {
+		uint8_t ccSamples[PSU_COUNT];	/* Consecutive observations in current limit before a trip (0: off) */
+		unsigned long int ccMicros[PSU_COUNT];	/* Continuous time in current limit before a trip in us (0: off) */
+		uint16_t currentLimit[PSU_COUNT];	/* Trip on measured current above this in uA (0: off) */
+		uint8_t arcsPerMinute[PSU_COUNT];	/* Tolerated micro arcs per minute (0: arc counting off) */
+	} protection;
 };
 
 void cfgeepromLoad();
@@ -45,6 +45,9 @@ struct rampMode rampMode;
 */
 void rampStart_InsulationTest() {
     unsigned long int i;
+
+    controllerPolarityCancel();
+
     /*@
         loop invariant 1 <= i <= 5;
         loop assigns psuStates[i-1].bOutputEnable;
@@ -80,6 +83,8 @@ void rampStart_BeamOn() {
     unsigned long int i;
     unsigned long int targetCurrent = filamentCurrent_GetCachedCurrent();
 
+    controllerPolarityCancel();
+
     /*@
         loop invariant 1 <= i <= 5;
         loop assigns psuStates[i-1].bOutputEnable;
@@ -120,6 +125,11 @@ void rampStart_BeamOn() {
     ensures rampMode.mode == controllerRampMode__None;
 */
 static void rampInsulationError() {
+    /*
+        Keep the waveform that lead to the failure (if a trace is armed)
+    */
+    adcTraceTrigger(ADC_TRACE_SOURCE_INSULATION);
+
     /*
         Write message
     */
@@ -129,6 +139,7 @@ static void rampInsulationError() {
         Disable everything
     */
     filamentCurrent_Enable(false);
+    controllerPolarityCancel();
 
     /*
         Stop ramp
@@ -180,12 +191,12 @@ static void handleRamp() {
 
             /* We start the sequence by setting voltage and PSU enable ... */
             /*@
-                loop invariant 0 <= i <= 4;
-                loop assigns rampMode.vCurrent[0 .. 3];
-                loop assigns psuStates[0 .. 3].bOutputEnable;
-                loop variant 4-i;
+                loop invariant 0 <= i <= CONTROLLER_RAMP_PSUS;
+                loop assigns rampMode.vCurrent[0 .. CONTROLLER_RAMP_PSUS-1];
+                loop assigns psuStates[0 .. CONTROLLER_RAMP_PSUS-1].bOutputEnable;
+                loop variant CONTROLLER_RAMP_PSUS-i;
             */
-            for(i = 0; i < 4; i=i+1) {
+            for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
                 rampMode.vCurrent[i] = ((rampMode.vCurrent[i] + cfgOptions.ramps.stepsizeV) > rampMode.vTargets[i]) ? rampMode.vTargets[i] : (rampMode.vCurrent[i] + cfgOptions.ramps.stepsizeV);
                 setPSUVolts(rampMode.vCurrent[i], i+1);
                 rampMessage_ReportVoltages();
@@ -197,11 +208,11 @@ static void handleRamp() {
             if(timeElapsed < cfgOptions.ramps.stepDuration) { return; }
 
             /*@
-                loop invariant 0 <= i <= 4;
-                loop assigns rampMode.vCurrent[0 .. 3];
-                loop variant 4-i;
+                loop invariant 0 <= i <= CONTROLLER_RAMP_PSUS;
+                loop assigns rampMode.vCurrent[0 .. CONTROLLER_RAMP_PSUS-1];
+                loop variant CONTROLLER_RAMP_PSUS-i;
             */
-            for(i = 0; i < 4; i=i+1) {
+            for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
                 rampMode.vCurrent[i] = ((rampMode.vCurrent[i] + cfgOptions.ramps.stepsizeV) > rampMode.vTargets[i]) ? rampMode.vTargets[i] : (rampMode.vCurrent[i] + cfgOptions.ramps.stepsizeV);
                 setPSUVolts(rampMode.vCurrent[i], i+1);
                 rampMessage_ReportVoltages();
@@ -215,7 +226,7 @@ static void handleRamp() {
         */
         if(rampMode.mode == controllerRampMode__InsulationTest) {
             rampMode.mode = controllerRampMode__None;
-            for(i = 0; i < 4; i=i+1) {
+            for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
                 setPSUVolts(0, i+1);
             }
             rampMessage_InsulationTestSuccess();
@@ -231,8 +242,277 @@ static void handleRamp() {
     }
 }
 
+/*
+    Keeps the thresholds of the overcurrent trip in the ADC ISR in sync with
+    the current limits of the active ramp. A PSU is only protected while it
+    is part of a ramp (target and current voltage set) and protection has
+    not been disabled. Thresholds are only recalculated on change.
+*/
+static unsigned long int overcurrentTripLimit[CONTROLLER_RAMP_PSUS] = { ULONG_MAX, ULONG_MAX, ULONG_MAX, ULONG_MAX };
+
+static void updateOvercurrentTripThresholds() {
+    unsigned long int i;
+    unsigned long int limits[CONTROLLER_RAMP_PSUS];
+    unsigned long int tenthMicroamps;
+    uint16_t threshold;
+
+    /* Same assignment of limits to PSUs as done by rampStart_* */
+    if(rampMode.mode == controllerRampMode__InsulationTest) {
+        limits[0] = cfgOptions.insulationCurrentLimits.wehneltCylinder;
+        limits[1] = cfgOptions.insulationCurrentLimits.cathode;
+        limits[2] = cfgOptions.insulationCurrentLimits.focus;
+        limits[3] = cfgOptions.insulationCurrentLimits.aux;
+    } else {
+        limits[0] = cfgOptions.beamOnCurrentLimits.wehneltCylinder;
+        limits[1] = cfgOptions.beamOnCurrentLimits.cathode;
+        limits[2] = cfgOptions.beamOnCurrentLimits.focus;
+        limits[3] = cfgOptions.beamOnCurrentLimits.aux;
+    }
+
+    for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
+        if((protectionEnabled == 0) || (rampMode.vTargets[i] == 0) || (rampMode.vCurrent[i] == 0)) {
+            limits[i] = 0;
+        }
+
+        if(limits[i] == overcurrentTripLimit[i]) {
+            continue;
+        }
+        overcurrentTripLimit[i] = limits[i];
+
+        if(limits[i] == 0) {
+            adcTripSetThreshold(psuDescriptors[i].adcCurrent, ADC_TRIP_DISABLED);
+        } else {
+            /*
+                Calibration of current channels is done in 0.1 uA on full
+                width readings, the trip compares raw 10 bit conversions so
+                the threshold is rounded up to the next raw count
+            */
+            tenthMicroamps = (limits[i] * (100 + CONTROLLER_OVERCURRENT_TRIP_MARGIN_PERCENT)) / 10;
+            threshold = adcCalibratedInverse((i << 1) + 1, (tenthMicroamps > 0xFFFF) ? 0xFFFF : (uint16_t)tenthMicroamps);
+            adcTripSetThreshold(psuDescriptors[i].adcCurrent, (threshold + (1 << (ADC_OVERSAMPLED_BITS - 10)) - 1) >> (ADC_OVERSAMPLED_BITS - 10));
+        }
+    }
+}
+
+/*
+    Reports channels whose output reached the setpoint since the last call
+*/
+static void handleSlewEvents() {
+    pwmoutMask doneMask = pwmoutSlewPollDone();
+
+    if(doneMask != 0) {
+        rampMessage_SlewDone(doneMask);
+    }
+}
+
+/*
+    Current limit events latched by the timer ISR are reported at most
+    every CONTROLLER_LIMIT_EVENT_MICROS so an oscillating PSU can not flood
+    the serial ports
+*/
+#define CONTROLLER_LIMIT_EVENT_MICROS 100000UL
+
+static uint8_t limitEventPending;
+static unsigned long int limitEventLastReport;
+
+static void handleLimitEventReport(
+    uint8_t events
+) {
+    unsigned long int now = micros();
+
+    limitEventPending = limitEventPending | events;
+    if((limitEventPending != 0) && ((now - limitEventLastReport) >= CONTROLLER_LIMIT_EVENT_MICROS)) {
+        rampMessage_LimitEvent(limitEventPending);
+        limitEventPending = 0;
+        limitEventLastReport = now;
+    }
+}
+
+/*
+    Protection policy state per PSU. The arc bucket counts in arc
+    milliseconds per minute: an arc adds 60000, every millisecond drains
+    arcsPerMinute
+*/
+#define CONTROLLER_ARC_WEIGHT 60000UL
+
+struct protectionState {
+    uint8_t                     ccCount;
+    uint8_t                     overCount;
+    unsigned long int           arcLevel;
+    unsigned long int           arcLast;
+    unsigned long int           arcSeen;
+};
+
+static struct protectionState protectionStates[PSU_COUNT];
+
+/*@
+    requires (psuIndex >= 0) && (psuIndex < PSU_COUNT);
+    assigns protectionStates[psuIndex];
+*/
+static void protectionReset(
+    uint8_t psuIndex,
+    unsigned long int now
+) {
+    struct psuLimitLatch latch;
+
+    psuLimitGetLatch(psuIndex, &latch);
+    protectionStates[psuIndex].ccCount = 0;
+    protectionStates[psuIndex].overCount = 0;
+    protectionStates[psuIndex].arcLevel = 0;
+    protectionStates[psuIndex].arcLast = now;
+    protectionStates[psuIndex].arcSeen = latch.count;
+}
+
+/*@
+    requires (psuIndex >= 0) && (psuIndex < PSU_COUNT);
+    assigns cfgOptions.protection;
+    assigns protectionStates[psuIndex];
+*/
+bool controllerProtectionConfigure(
+    uint8_t psuIndex,
+    uint8_t ccSamples,
+    unsigned long int ccMicros,
+    uint16_t currentLimit,
+    uint8_t arcsPerMinute
+) {
+    if((psuIndex >= PSU_COUNT) || (ccSamples > CONTROLLER_PROTECTION_CCSAMPLES_MAX) || (ccMicros > CONTROLLER_PROTECTION_CCMICROS_MAX)) {
+        return false;
+    }
+
+    cfgOptions.protection.ccSamples[psuIndex] = ccSamples;
+    cfgOptions.protection.ccMicros[psuIndex] = ccMicros;
+    cfgOptions.protection.currentLimit[psuIndex] = currentLimit;
+    cfgOptions.protection.arcsPerMinute[psuIndex] = arcsPerMinute;
+    protectionReset(psuIndex, micros());
+
+    return true;
+}
+
+/*@
+    assigns cfgOptions.protection;
+*/
+void controllerProtectionValidate() {
+    unsigned long int i;
+
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        if((cfgOptions.protection.ccSamples[i] > CONTROLLER_PROTECTION_CCSAMPLES_MAX) || (cfgOptions.protection.ccMicros[i] > CONTROLLER_PROTECTION_CCMICROS_MAX)) {
+            cfgOptions.protection.ccSamples[i] = CONTROLLER_PROTECTION_CCSAMPLES_DEFAULT;
+            cfgOptions.protection.ccMicros[i] = 0;
+            cfgOptions.protection.currentLimit[i] = 0;
+            cfgOptions.protection.arcsPerMinute[i] = 0;
+        }
+    }
+}
+
+/*
+    Evaluates the protection rules of a PSU that is part of a running
+    ramp. Returns the rule that fired (CONTROLLER_PROTECTION_*) or 0
+*/
+/*@
+    requires (psuIndex >= 0) && (psuIndex < PSU_COUNT);
+    assigns protectionStates[psuIndex];
+*/
+static uint8_t protectionEvaluate(
+    uint8_t psuIndex,
+    unsigned long int now
+) {
+    struct protectionState* lpState = &(protectionStates[psuIndex]);
+    struct psuLimitLatch latch;
+    bool bCurrentLimit = (psuStates[psuIndex].limitMode == psuLimit_Current) ? true : false;
+    uint8_t arcsPerMinute = cfgOptions.protection.arcsPerMinute[psuIndex];
+    uint8_t samples;
+    unsigned long int elapsedMillis;
+    unsigned long int newArcs;
+
+    psuLimitGetLatch(psuIndex, &latch);
+    newArcs = latch.count - lpState->arcSeen;
+    lpState->arcSeen = latch.count;
+
+    if(arcsPerMinute != 0) {
+        /* Drain in whole milliseconds, the remainder stays in arcLast */
+        elapsedMillis = (now - lpState->arcLast) / 1000;
+        lpState->arcLast = lpState->arcLast + elapsedMillis * 1000;
+        if(elapsedMillis > 60000) {
+            elapsedMillis = 60000;
+        }
+        lpState->arcLevel = (lpState->arcLevel > (elapsedMillis * arcsPerMinute)) ? (lpState->arcLevel - (elapsedMillis * arcsPerMinute)) : 0;
+
+        if(newArcs > arcsPerMinute) {
+            newArcs = arcsPerMinute + 1;
+        }
+        lpState->arcLevel = lpState->arcLevel + newArcs * CONTROLLER_ARC_WEIGHT;
+        if(lpState->arcLevel > ((unsigned long int)arcsPerMinute) * CONTROLLER_ARC_WEIGHT) {
+            return CONTROLLER_PROTECTION_ARCS;
+        }
+    } else if(newArcs != 0) {
+        /* Excursion shorter than a main loop iteration */
+        bCurrentLimit = true;
+    }
+
+    samples = cfgOptions.protection.ccSamples[psuIndex];
+    if(bCurrentLimit == true) {
+        if(lpState->ccCount != 0xFF) {
+            lpState->ccCount = lpState->ccCount + 1;
+        }
+    } else {
+        lpState->ccCount = 0;
+    }
+    if((samples != 0) && (lpState->ccCount >= samples)) {
+        return CONTROLLER_PROTECTION_CCSAMPLES;
+    }
+
+    if((cfgOptions.protection.ccMicros[psuIndex] != 0) && (psuStates[psuIndex].limitMode == psuLimit_Current)) {
+        if((now - latch.entryMicros) >= cfgOptions.protection.ccMicros[psuIndex]) {
+            return CONTROLLER_PROTECTION_CCTIME;
+        }
+    }
+
+    if(cfgOptions.protection.currentLimit[psuIndex] != 0) {
+        /* Calibration of current channels is done in 0.1 uA */
+        if(((unsigned long int)adcCalibratedValue((psuIndex << 1) + 1, psuStates[psuIndex].realI)) > ((unsigned long int)cfgOptions.protection.currentLimit[psuIndex]) * 10) {
+            if(lpState->overCount != 0xFF) {
+                lpState->overCount = lpState->overCount + 1;
+            }
+        } else {
+            lpState->overCount = 0;
+        }
+        if(lpState->overCount >= ((samples != 0) ? samples : 1)) {
+            return CONTROLLER_PROTECTION_CURRENT;
+        }
+    }
+
+    return 0;
+}
+
 static void handleOvercurrentDetection() {
     unsigned long int i;
+    struct adcTripStatus trip;
+    uint8_t limitEvents = psuLimitFetchEvents();
+    uint8_t rule;
+    unsigned long int now = micros();
+
+    handleLimitEventReport(limitEvents);
+
+    /*
+        The ADC ISR has already disabled all outputs in case of a trip. We
+        only have to bring our own state in line (setpoints zero, ramp
+        stopped) and report the event
+    */
+    if(adcTripPoll(&trip) == true) {
+        for(i = 0; i < PSU_COUNT; i=i+1) {
+            setPSUVolts(0, i+1);
+            setPSUMicroamps(psuStates[i].setILimit, i+1);
+        }
+        for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
+            rampMode.vCurrent[i] = 0;
+        }
+        rampMessage_OvercurrentTrip(&trip);
+        rampInsulationError();
+        updateOvercurrentTripThresholds();
+        return;
+    }
+
+    updateOvercurrentTripThresholds();
 
     /*
         Periodically check if any of the PSUs went into current limiting
@@ -240,18 +520,243 @@ static void handleOvercurrentDetection() {
         case disable everything and signal fault ...
     */
 
-    if(protectionEnabled != 0) {
-        for(i = 0; i < 4; i=i+1) {
-            if((rampMode.vTargets[i] > 0) && (rampMode.vCurrent[i] > 0) && (psuStates[i].limitMode == psuLimit_Current)) {
-                rampInsulationError();
-                return;
+    for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
+        if((protectionEnabled == 0) || (rampMode.vTargets[i] == 0) || (rampMode.vCurrent[i] == 0)) {
+            protectionReset(i, now);
+            continue;
+        }
+
+        rule = protectionEvaluate(i, now);
+        if(rule != 0) {
+            rampMessage_ProtectionTrip(i, rule);
+            rampInsulationError();
+            for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
+                protectionReset(i, now);
             }
+            return;
         }
     }
 }
 
+/*
+    Polarity sequencer
+*/
+#define CONTROLLER_POLARITY_IDLE        0
+#define CONTROLLER_POLARITY_RAMPDOWN    1   /* Waiting for the output to be disabled */
+#define CONTROLLER_POLARITY_DISCHARGE   2   /* Waiting for the readout to drop */
+#define CONTROLLER_POLARITY_SETTLE      3   /* Relay switched, waiting for contacts */
+
+struct polaritySequence {
+    uint8_t                     state;
+    enum psuPolarity            polTarget;
+    uint16_t                    vRestore;
+    unsigned long int           clkStarted;
+};
+
+static struct polaritySequence polaritySequences[PSU_COUNT];
+
+/*@
+    requires (psuIndex >= 0) && (psuIndex < PSU_COUNT);
+    assigns polaritySequences[psuIndex];
+*/
+static void polaritySequenceFinish(
+    uint8_t psuIndex,
+    bool bSuccess
+) {
+    polaritySequences[psuIndex].state = CONTROLLER_POLARITY_IDLE;
+    rampMessage_PolarityDone(psuIndex, (bSuccess == true) ? (uint8_t)((psuStates[psuIndex].polPolarity == psuPolarity_Positive) ? 'p' : 'n') : 'f');
+}
+
+bool controllerPolarityRequest(
+    uint8_t psuIndex,
+    bool bNegative
+) {
+    struct polaritySequence* lpSeq;
+    enum psuPolarity polTarget = (bNegative == true) ? psuPolarity_Negative : psuPolarity_Positive;
+
+    if(psuIndex >= PSU_COUNT) {
+        return false;
+    }
+    lpSeq = &(polaritySequences[psuIndex]);
+
+    if(lpSeq->state != CONTROLLER_POLARITY_IDLE) {
+        /* The target may only change as long as the relay has not been switched */
+        if(lpSeq->polTarget == polTarget) {
+            return true;
+        }
+        if(lpSeq->state == CONTROLLER_POLARITY_SETTLE) {
+            return false;
+        }
+        lpSeq->polTarget = polTarget;
+        return true;
+    }
+
+    if(psuStates[psuIndex].polPolarity == polTarget) {
+        polaritySequenceFinish(psuIndex, true);
+        return true;
+    }
+
+    lpSeq->polTarget = polTarget;
+    lpSeq->vRestore = psuStates[psuIndex].setVTarget;
+    lpSeq->clkStarted = micros();
+    lpSeq->state = CONTROLLER_POLARITY_RAMPDOWN;
+
+    /* A waveform would bypass the slope limiter */
+    pwmoutWaveformStop(psuDescriptors[psuIndex].pwmVoltage);
+    setPSUVolts(0, psuIndex + 1);
+
+    return true;
+}
+
+void controllerPolarityCancel() {
+    unsigned long int i;
+
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        if(polaritySequences[i].state != CONTROLLER_POLARITY_IDLE) {
+            polaritySequenceFinish(i, false);
+        }
+    }
+}
+
+/*
+    Advances every running polarity change by at most one step. Never
+    waits so all other PSUs and the ramp keep being serviced
+*/
+static void handlePolaritySequencer() {
+    unsigned long int i;
+    unsigned long int now = micros();
+    struct polaritySequence* lpSeq;
+
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        lpSeq = &(polaritySequences[i]);
+        if(lpSeq->state == CONTROLLER_POLARITY_IDLE) {
+            continue;
+        }
+
+        /*
+            Voltages set while the output is held at zero become the
+            voltage that gets restored
+        */
+        if(psuStates[i].setVTarget != 0) {
+            lpSeq->vRestore = psuStates[i].setVTarget;
+            pwmoutWaveformStop(psuDescriptors[i].pwmVoltage);
+            setPSUVolts(0, i + 1);
+        }
+
+        switch(lpSeq->state) {
+            case CONTROLLER_POLARITY_RAMPDOWN:
+                if(psuStates[i].bOutputEnable == true) {
+                    break;
+                }
+                lpSeq->clkStarted = now;
+                lpSeq->state = CONTROLLER_POLARITY_DISCHARGE;
+                /* Fall through */
+            case CONTROLLER_POLARITY_DISCHARGE:
+                if(adcCalibratedValue(i << 1, psuStates[i].realV) >= CONTROLLER_POLARITY_DISCHARGE_VOLTS) {
+                    if((now - lpSeq->clkStarted) >= CONTROLLER_POLARITY_DISCHARGE_TIMEOUT_MICROS) {
+                        /* Keep the setpoint at zero, the output did not discharge */
+                        polaritySequenceFinish(i, false);
+                    }
+                    break;
+                }
+                /* psuSetOutputs writes the relay during the next iteration */
+                psuStates[i].polPolarity = lpSeq->polTarget;
+                lpSeq->clkStarted = now;
+                lpSeq->state = CONTROLLER_POLARITY_SETTLE;
+                break;
+            case CONTROLLER_POLARITY_SETTLE:
+                if((now - lpSeq->clkStarted) < CONTROLLER_POLARITY_SETTLE_MICROS) {
+                    break;
+                }
+                setPSUVolts(lpSeq->vRestore, i + 1);
+                polaritySequenceFinish(i, true);
+                break;
+            default:
+                lpSeq->state = CONTROLLER_POLARITY_IDLE;
+                break;
+        }
+    }
+}
+
+struct controllerProfile controllerProfile;
+
+/*@
+    assigns controllerProfile;
+*/
+void controllerProfileReset() {
+    unsigned long int i;
+
+    for(i = 0; i < CONTROLLER_PROFILE_STAGES; i=i+1) {
+        controllerProfile.stages[i].min = ULONG_MAX;
+        controllerProfile.stages[i].max = 0;
+        controllerProfile.stages[i].sum = 0;
+        controllerProfile.stages[i].count = 0;
+    }
+    for(i = 0; i < CONTROLLER_PROFILE_HISTOGRAM_BINS; i=i+1) {
+        controllerProfile.histogram[i] = 0;
+    }
+}
+
+/*@
+    requires (stage >= 0) && (stage < CONTROLLER_PROFILE_STAGES);
+    assigns controllerProfile.stages[stage];
+*/
+static void controllerProfileRecord(
+    uint8_t stage,
+    unsigned long int duration
+) {
+    struct controllerProfileStage* lpStage = &(controllerProfile.stages[stage]);
+
+    if(duration < lpStage->min) { lpStage->min = duration; }
+    if(duration > lpStage->max) { lpStage->max = duration; }
+
+    /* Halve sum and count instead of overflowing (keeps the average) */
+    if((lpStage->sum > (ULONG_MAX - duration)) || (lpStage->count == ULONG_MAX)) {
+        lpStage->sum = lpStage->sum >> 1;
+        lpStage->count = lpStage->count >> 1;
+    }
+    lpStage->sum = lpStage->sum + duration;
+    lpStage->count = lpStage->count + 1;
+}
+
+/*
+    Records the time since *lpLast for the given stage and advances *lpLast
+*/
+static inline void controllerProfileStage(
+    uint8_t stage,
+    unsigned long int* lpLast
+) {
+    unsigned long int now = micros();
+
+    controllerProfileRecord(stage, now - (*lpLast));
+    *lpLast = now;
+}
+
+/*@
+    assigns controllerProfile.stages[CONTROLLER_PROFILE_LOOP];
+    assigns controllerProfile.histogram[0 .. CONTROLLER_PROFILE_HISTOGRAM_BINS-1];
+*/
+static void controllerProfileLoop(
+    unsigned long int duration
+) {
+    uint8_t bin = 0;
+    unsigned long int d = duration >> 1;
+
+    controllerProfileRecord(CONTROLLER_PROFILE_LOOP, duration);
+
+    while((d != 0) && (bin < (CONTROLLER_PROFILE_HISTOGRAM_BINS - 1))) {
+        d = d >> 1;
+        bin = bin + 1;
+    }
+    if(controllerProfile.histogram[bin] != 0xFFFF) {
+        controllerProfile.histogram[bin] = controllerProfile.histogram[bin] + 1;
+    }
+}
 
 int main() {
+    unsigned long int clkLoopStart;
+    unsigned long int clkStage;
+
     #ifndef FRAMAC_SKIP
 		cli();
 	#endif
@@ -292,6 +797,7 @@ int main() {
     /* Load configuration values from EEPROM */
     cfgeepromLoad();
     //cfgeepromDefaults();
+    controllerProtectionValidate();
 
     /*
         Setup serial
@@ -330,6 +836,8 @@ int main() {
     */
     rampMode.mode = controllerRampMode__None;
 
+    controllerProfileReset();
+
     for(;;) {
         /*
             This is the main application loop. It works in a hybrid synchronous
@@ -338,18 +846,36 @@ int main() {
             this won't satisfy any timing constraints but there is no need
             for such constraints during slow control of the experiment
         */
+        clkLoopStart = micros();
+        clkStage = clkLoopStart;
+
         handleSerial0Messages(); /* main external serial interface */
+        controllerProfileStage(CONTROLLER_PROFILE_SERIAL0, &clkStage);
         #ifdef SERIAL_UART1_ENABLE
             handleSerial1Messages(); /* Serial port for status reports */
+            controllerProfileStage(CONTROLLER_PROFILE_SERIAL1, &clkStage);
         #endif
         #ifdef SERIAL_UART2_ENABLE
             handleSerial2Messages(); /* Serial port for status reports */
+            controllerProfileStage(CONTROLLER_PROFILE_SERIAL2, &clkStage);
         #endif
 
         psuUpdateMeasuredState();
+        controllerProfileStage(CONTROLLER_PROFILE_PSUMEASURE, &clkStage);
+        pwmoutTrimUpdate();
+        controllerProfileStage(CONTROLLER_PROFILE_TRIM, &clkStage);
+        handleSlewEvents();
+        controllerProfileStage(CONTROLLER_PROFILE_SLEWEVENTS, &clkStage);
         psuSetOutputs();
+        controllerProfileStage(CONTROLLER_PROFILE_PSUOUTPUTS, &clkStage);
 
         handleRamp();
+        controllerProfileStage(CONTROLLER_PROFILE_RAMP, &clkStage);
+        handlePolaritySequencer();
+        controllerProfileStage(CONTROLLER_PROFILE_POLARITY, &clkStage);
         handleOvercurrentDetection();
+        controllerProfileStage(CONTROLLER_PROFILE_OVERCURRENT, &clkStage);
+
+        controllerProfileLoop(clkStage - clkLoopStart);
     }
 }
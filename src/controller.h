@@ -1,9 +1,25 @@
 #ifndef __is_included__d81475f8_df0f_11eb_ba7e_b499badf00a1
 #define __is_included__d81475f8_df0f_11eb_ba7e_b499badf00a1 1
 
+#ifndef __cplusplus
+    #ifndef true
+        #define true 1
+        #define false 0
+        typedef unsigned char bool;
+    #endif
+#endif
+
 #define SERIAL_UART1_ENABLE 1
 #define SERIAL_UART2_ENABLE 0
 
+/*
+    Overcurrent trip inside the ADC ISR fires this many percent above the
+    configured current limit of the running ramp
+*/
+#ifndef CONTROLLER_OVERCURRENT_TRIP_MARGIN_PERCENT
+    #define CONTROLLER_OVERCURRENT_TRIP_MARGIN_PERCENT 10
+#endif
+
 #if 0
     #ifndef CONTROLLER_RAMP_TARGETV__K
         #define CONTROLLER_RAMP_TARGETV__K 2000
@@ -52,6 +68,13 @@ enum controllerRampMode {
 extern struct rampMode rampMode;
 extern int protectionEnabled;
 
+/*
+    The ramps drive the electron gun supplies PSU 1 ... 4 (wehnelt,
+    cathode, focus, aux). Further PSUs (PSU_COUNT) are not ramped and not
+    covered by the insulation fault detection
+*/
+#define CONTROLLER_RAMP_PSUS 4
+
 struct rampMode {
     /*
         Modes:
@@ -62,7 +85,7 @@ struct rampMode {
             Inulation test          Increase HV checking for insulation fault
     */
     enum controllerRampMode         mode;
-    uint16_t                        vTargets[4];
+    uint16_t                        vTargets[CONTROLLER_RAMP_PSUS];
     uint16_t                        aTargetFilament;
 
     /*
@@ -71,7 +94,7 @@ struct rampMode {
             filamentCurrent     The currently set filament current
             clkStarted          millis() when the process started (note wrap around when calculating)
     */
-    uint16_t                        vCurrent[4];
+    uint16_t                        vCurrent[CONTROLLER_RAMP_PSUS];
     uint16_t                        filamentCurrent;
     unsigned long int               clkLastTick;
 };
@@ -79,4 +102,128 @@ struct rampMode {
 void rampStart_InsulationTest();
 void rampStart_BeamOn();
 
+/*
+    Polarity sequencer
+
+        The polarity relay of a PSU is only switched without high voltage.
+        A change request takes the voltage setpoint to zero (through the
+        slope limiter), waits till the output is disabled and the readout
+        dropped below CONTROLLER_POLARITY_DISCHARGE_VOLTS, switches the
+        relay, waits CONTROLLER_POLARITY_SETTLE_MICROS and restores the
+        previous setpoint. Voltages set while a change runs are restored
+        instead. Runs step by step from the main loop, every PSU has its own
+        sequence. Each sequence reports its result ($$$poldone). If the
+        output does not discharge within
+        CONTROLLER_POLARITY_DISCHARGE_TIMEOUT_MICROS after being disabled the
+        polarity is left unchanged and the setpoint stays zero. Emergency off, trips and ramp starts
+        cancel all sequences without restoring voltages.
+*/
+#ifndef CONTROLLER_POLARITY_DISCHARGE_VOLTS
+    #define CONTROLLER_POLARITY_DISCHARGE_VOLTS 50
+#endif
+#ifndef CONTROLLER_POLARITY_DISCHARGE_TIMEOUT_MICROS
+    #define CONTROLLER_POLARITY_DISCHARGE_TIMEOUT_MICROS 10000000UL
+#endif
+#ifndef CONTROLLER_POLARITY_SETTLE_MICROS
+    #define CONTROLLER_POLARITY_SETTLE_MICROS 100000UL
+#endif
+
+/*
+    Requests positive (bNegative false) or negative polarity for PSU
+    psuIndex. Returns false for unknown PSUs and once a running change
+    to the other polarity has already switched the relay
+*/
+bool controllerPolarityRequest(
+    uint8_t psuIndex,
+    bool bNegative
+);
+void controllerPolarityCancel();
+
+/*
+    Protection policy
+
+        While a PSU is part of a running ramp (and protection is enabled)
+        every main loop iteration evaluates the rules configured in
+        cfgOptions.protection for it, any rule firing raises an insulation
+        error:
+
+            ccSamples       Current limit observed in this many consecutive
+                            iterations. Latched transitions from the timer
+                            ISR count as observation unless arc counting
+                            is enabled
+            ccMicros        PSU continuously in current limit for this time
+            currentLimit    Measured current above the threshold for
+                            ccSamples (at least one) consecutive iterations
+            arcsPerMinute   Every latched transition into current limit is a
+                            micro arc. Arcs fill a leaky bucket drained by
+                            arcsPerMinute per minute, exceeding it trips
+*/
+#define CONTROLLER_PROTECTION_CCSAMPLES     1
+#define CONTROLLER_PROTECTION_CCTIME        2
+#define CONTROLLER_PROTECTION_CURRENT       3
+#define CONTROLLER_PROTECTION_ARCS          4
+
+/*
+    Default policy (3:0:0:0): Current limit has to be observed in three
+    consecutive iterations so a single micro arc does not end the ramp.
+    Hard overcurrent is still caught by the trip inside the ADC ISR.
+    Upper bounds of ccSamples and ccMicros. Stored policies exceeding them
+    are replaced by the default on startup
+*/
+#define CONTROLLER_PROTECTION_CCSAMPLES_DEFAULT 3
+#define CONTROLLER_PROTECTION_CCSAMPLES_MAX 100
+#define CONTROLLER_PROTECTION_CCMICROS_MAX  10000000UL
+
+void controllerProtectionValidate();
+
+bool controllerProtectionConfigure(
+    uint8_t psuIndex,
+    uint8_t ccSamples,
+    unsigned long int ccMicros,
+    uint16_t currentLimit,
+    uint8_t arcsPerMinute
+);
+
+/*
+    Main loop profiler
+
+        Every stage of the main loop is timed with micros() (4 us
+        resolution). For every stage and for the whole iteration minimum,
+        maximum and sum (for the average) are kept, iteration times are
+        additionally collected in a log2 histogram (bin n counts iterations
+        taking 2^n ... 2^(n+1)-1 microseconds, the last bin everything above).
+        Stages added later are numbered after CONTROLLER_PROFILE_LOOP so
+        existing stage numbers stay valid
+*/
+#define CONTROLLER_PROFILE_SERIAL0          0
+#define CONTROLLER_PROFILE_SERIAL1          1
+#define CONTROLLER_PROFILE_SERIAL2          2
+#define CONTROLLER_PROFILE_PSUMEASURE       3
+#define CONTROLLER_PROFILE_PSUOUTPUTS       4
+#define CONTROLLER_PROFILE_RAMP             5
+#define CONTROLLER_PROFILE_OVERCURRENT      6
+#define CONTROLLER_PROFILE_LOOP             7
+#define CONTROLLER_PROFILE_TRIM             8
+#define CONTROLLER_PROFILE_SLEWEVENTS       9
+#define CONTROLLER_PROFILE_POLARITY         10
+#define CONTROLLER_PROFILE_STAGES           11
+
+#define CONTROLLER_PROFILE_HISTOGRAM_BINS   16
+
+struct controllerProfileStage {
+    unsigned long int               min;
+    unsigned long int               max;
+    unsigned long int               sum;
+    unsigned long int               count;
+};
+
+struct controllerProfile {
+    struct controllerProfileStage   stages[CONTROLLER_PROFILE_STAGES];
+    uint16_t                        histogram[CONTROLLER_PROFILE_HISTOGRAM_BINS];
+};
+
+extern struct controllerProfile controllerProfile;
+
+void controllerProfileReset();
+
 #endif /* #ifndef __is_included__d81475f8_df0f_11eb_ba7e_b499badf00a1 */
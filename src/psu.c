@@ -5,280 +5,573 @@
 #include "./sysclock.h"
 #include "./psu.h"
 #include "./adc.h"
+#include "./pwmout.h"
+#include "./cfgeeprom.h"
 
 #ifdef __cplusplus
     extern "C" {
 #endif
 
-struct psuState psuStates[4];
+struct psuState psuStates[PSU_COUNT];
+
+/*
+    PSU descriptors
+
+        One row per PSU. Everything working on PSU pins, readouts or
+        setpoints uses this table; the per port masks are derived from it
+        in psuInit and the PWM channels of the cathode and wehnelt roles
+        in pwmoutInit. PSU 5 and 6 are the second deflector pair of the
+        PSU_COUNT 6 build.
+*/
+const struct psuDescriptor psuDescriptors[PSU_COUNT] = {
+    /* ADC V, I  PWM V, I  Port        Enable Polarity Limit  Initial polarity      Roles             ADC V/count ADC 0.1uA/count PWM V/on cycle  PWM uA/on cycle */
+    { 0, 1,      0, 1,     PSU_PORT_A, 0x01,  0x02,    0x04,  psuPolarity_Negative, PSU_ROLE_CATHODE, 3.221407,   9.765625,       PWM_VPERDIVK,   PWM_VPERUA },
+    { 2, 3,      2, 3,     PSU_PORT_A, 0x10,  0x20,    0x40,  psuPolarity_Negative, PSU_ROLE_WEHNELT, 3.221407,   9.765625,       PWM_VPERDIVW,   PWM_VPERUA },
+    { 4, 5,      4, 5,     PSU_PORT_C, 0x80,  0x40,    0x20,  psuPolarity_Negative, PSU_ROLE_NONE,    3.221407,   9.765625,       PWM_VPERDIVFOC, PWM_VPERUA },
+    { 6, 7,      6, 7,     PSU_PORT_C, 0x08,  0x04,    0x02,  psuPolarity_Positive, PSU_ROLE_NONE,    3.221407,   9.765625,       PWM_VPERDIV4,   PWM_VPERUA }
+    #if PSU_COUNT > 4
+        ,
+        { 12, 13,    8, 9,     PSU_PORT_G, 0x01,  0x02,    0x04,  psuPolarity_Positive, PSU_ROLE_NONE,    3.221407,   9.765625,       PWM_VPERDIV4,   PWM_VPERUA }
+    #endif
+    #if PSU_COUNT > 5
+        ,
+        { 14, 15,    10, 11,   PSU_PORT_E, 0x08,  0x10,    0x20,  psuPolarity_Positive, PSU_ROLE_NONE,    3.221407,   9.765625,       PWM_VPERDIV4,   PWM_VPERUA }
+    #endif
+};
+
+static uint8_t psuPortOutputMask[PSU_PORTS];
+static uint8_t psuPortLimitMask[PSU_PORTS];
+
+/*
+    Current limit latch state, written by the timer ISR
+*/
+static struct psuLimitLatch psuLimitLatches[PSU_COUNT];
+static uint8_t psuLimitLastPins[PSU_PORTS];
+static volatile uint8_t psuLimitEventMask;
+
+/*@
+    requires (port >= 0) && (port < PSU_PORTS);
+    assigns \nothing;
+*/
+static inline uint8_t psuPortRead(
+    uint8_t port
+) {
+    switch(port) {
+        case PSU_PORT_A:    return PORTA;
+        #if PSU_PORTS > 2
+            case PSU_PORT_G:    return PORTG;
+        #endif
+        #if PSU_PORTS > 3
+            case PSU_PORT_E:    return PORTE;
+        #endif
+        default:            return PORTC;
+    }
+}
+
+/*@
+    requires (port >= 0) && (port < PSU_PORTS);
+    assigns PORTA, PORTC, PORTG, PORTE;
+*/
+static inline void psuPortWrite(
+    uint8_t port,
+    uint8_t value
+) {
+    switch(port) {
+        case PSU_PORT_A:    PORTA = value; break;
+        #if PSU_PORTS > 2
+            case PSU_PORT_G:    PORTG = value; break;
+        #endif
+        #if PSU_PORTS > 3
+            case PSU_PORT_E:    PORTE = value; break;
+        #endif
+        default:            PORTC = value; break;
+    }
+}
+
+/*
+    Reads the PIN registers of all PSU ports
+*/
+/*@
+    requires \valid(&(lpPins[0 .. PSU_PORTS-1]));
+    assigns lpPins[0 .. PSU_PORTS-1];
+*/
+static inline void psuPortReadPins(
+    uint8_t* lpPins
+) {
+    lpPins[PSU_PORT_A] = PINA;
+    lpPins[PSU_PORT_C] = PINC;
+    #if PSU_PORTS > 2
+        lpPins[PSU_PORT_G] = PING;
+    #endif
+    #if PSU_PORTS > 3
+        lpPins[PSU_PORT_E] = PINE;
+    #endif
+}
+
+/*
+    Output bits of PSU psuIndex according to its state
+*/
+/*@
+    requires (psuIndex >= 0) && (psuIndex < PSU_COUNT);
+    assigns \nothing;
+*/
+static inline uint8_t psuOutputBits(
+    uint8_t psuIndex
+) {
+    uint8_t bits = 0;
+
+    if(psuStates[psuIndex].bOutputEnable == true) {
+        bits = bits | psuDescriptors[psuIndex].enableMask;
+    }
+    if(psuStates[psuIndex].polPolarity != psuPolarity_Positive) {
+        bits = bits | psuDescriptors[psuIndex].polarityMask;
+    }
+    return bits;
+}
+
+/*@
+    assigns psuLimitLatches[0 .. PSU_COUNT-1];
+    assigns psuLimitLastPins[0 .. PSU_PORTS-1];
+    assigns psuLimitEventMask;
+*/
+void psuLimitSample() {
+    uint8_t pins[PSU_PORTS];
+    uint8_t i;
+    uint8_t mask;
+    unsigned long int now;
+
+    psuPortReadPins(pins);
+
+    if((((pins[PSU_PORT_A] ^ psuLimitLastPins[PSU_PORT_A]) & psuPortLimitMask[PSU_PORT_A]) == 0)
+        && (((pins[PSU_PORT_C] ^ psuLimitLastPins[PSU_PORT_C]) & psuPortLimitMask[PSU_PORT_C]) == 0)
+        #if PSU_PORTS > 2
+            && (((pins[PSU_PORT_G] ^ psuLimitLastPins[PSU_PORT_G]) & psuPortLimitMask[PSU_PORT_G]) == 0)
+        #endif
+        #if PSU_PORTS > 3
+            && (((pins[PSU_PORT_E] ^ psuLimitLastPins[PSU_PORT_E]) & psuPortLimitMask[PSU_PORT_E]) == 0)
+        #endif
+    ) {
+        return;
+    }
+
+    now = micros();
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        mask = psuDescriptors[i].limitMask;
+        if(((pins[psuDescriptors[i].port] ^ psuLimitLastPins[psuDescriptors[i].port]) & mask) == 0) {
+            continue;
+        }
+
+        if((pins[psuDescriptors[i].port] & mask) != 0) {
+            psuLimitLatches[i].count = psuLimitLatches[i].count + 1;
+            psuLimitLatches[i].entryMicros = now;
+            psuLimitEventMask = psuLimitEventMask | (0x01 << i);
+        } else {
+            psuLimitLatches[i].exitMicros = now;
+        }
+    }
+
+    for(i = 0; i < PSU_PORTS; i=i+1) {
+        psuLimitLastPins[i] = pins[i];
+    }
+}
+
+/*@
+    assigns psuLimitEventMask;
+*/
+uint8_t psuLimitFetchEvents() {
+    uint8_t events;
+    uint8_t sregOld = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    events = psuLimitEventMask;
+    psuLimitEventMask = 0;
+    SREG = sregOld;
+
+    return events;
+}
+
+/*@
+    requires \valid(lpOut);
+    assigns *lpOut;
+*/
+bool psuLimitGetLatch(
+    uint8_t psuIndex,
+    struct psuLimitLatch* lpOut
+) {
+    uint8_t sregOld;
+
+    if(psuIndex >= PSU_COUNT) {
+        return false;
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    *lpOut = psuLimitLatches[psuIndex];
+    SREG = sregOld;
+
+    return true;
+}
+
+/*
+    Filter stage
+
+        Every PSU voltage and current (filter channel 2*PSU and 2*PSU+1)
+        can be filtered by an exponential moving average (alpha = 2^-shift)
+        or a 3 or 5 tap median for spike rejection. Filters run on the
+        oversampled ADC values and are only advanced when a new ADC block
+        has been published so their time constant does not depend on the
+        main loop speed. Each step takes constant time.
+*/
+struct psuFilterState {
+    uint32_t                    ema;
+    uint16_t                    history[5];
+    uint8_t                     historyPos;
+    bool                        bPrimed;
+};
+
+static struct psuFilterState psuFilters[PSU_FILTER_CHANNELS];
+static uint16_t psuFilterLastSequence;
+
+#define PSU_FILTER_SORT(a,b) { if((a) > (b)) { uint16_t t = (a); (a) = (b); (b) = t; } }
+
+/*@
+    requires (channel >= 0) && (channel < PSU_FILTER_CHANNELS);
+    assigns psuFilters[channel];
+*/
+static uint16_t psuFilterApply(
+    uint8_t channel,
+    uint16_t value
+) {
+    struct psuFilterState* lpState = &(psuFilters[channel]);
+    uint16_t taps[5];
+    uint8_t i;
+
+    if(lpState->bPrimed != true) {
+        /* Start from the first sample instead of ramping up from zero */
+        lpState->ema = ((uint32_t)value) << cfgOptions.psuFilter.emaShift[channel];
+        for(i = 0; i < 5; i=i+1) {
+            lpState->history[i] = value;
+        }
+        lpState->historyPos = 0;
+        lpState->bPrimed = true;
+    }
+
+    switch(cfgOptions.psuFilter.mode[channel]) {
+        case PSU_FILTER_EMA:
+            lpState->ema = lpState->ema - (lpState->ema >> cfgOptions.psuFilter.emaShift[channel]) + value;
+            return (uint16_t)(lpState->ema >> cfgOptions.psuFilter.emaShift[channel]);
+        case PSU_FILTER_MEDIAN3:
+            lpState->history[lpState->historyPos] = value;
+            lpState->historyPos = (lpState->historyPos >= 2) ? 0 : (lpState->historyPos + 1);
+            taps[0] = lpState->history[0]; taps[1] = lpState->history[1]; taps[2] = lpState->history[2];
+            PSU_FILTER_SORT(taps[0], taps[1]);
+            PSU_FILTER_SORT(taps[1], taps[2]);
+            PSU_FILTER_SORT(taps[0], taps[1]);
+            return taps[1];
+        case PSU_FILTER_MEDIAN5:
+            lpState->history[lpState->historyPos] = value;
+            lpState->historyPos = (lpState->historyPos >= 4) ? 0 : (lpState->historyPos + 1);
+            for(i = 0; i < 5; i=i+1) {
+                taps[i] = lpState->history[i];
+            }
+            PSU_FILTER_SORT(taps[0], taps[1]);
+            PSU_FILTER_SORT(taps[3], taps[4]);
+            PSU_FILTER_SORT(taps[0], taps[3]);
+            PSU_FILTER_SORT(taps[1], taps[4]);
+            PSU_FILTER_SORT(taps[1], taps[2]);
+            PSU_FILTER_SORT(taps[2], taps[3]);
+            PSU_FILTER_SORT(taps[1], taps[2]);
+            return taps[2];
+        default:
+            return value;
+    }
+}
 
 /*@
-    assigns psuStates[0 .. 3].limitMode;
-    assigns psuStates[0 .. 3].realV;
-    assigns psuStates[0 .. 3].realI;
+    requires (channel >= 0) && (channel < PSU_FILTER_CHANNELS);
+
+    assigns cfgOptions.psuFilter.mode[channel];
+    assigns cfgOptions.psuFilter.emaShift[channel];
+    assigns psuFilters[channel].bPrimed;
+*/
+bool psuFilterConfigure(
+    uint8_t channel,
+    uint8_t mode,
+    uint8_t emaShift
+) {
+    if((channel >= PSU_FILTER_CHANNELS) || (mode > PSU_FILTER_MEDIAN5) || (emaShift > PSU_FILTER_EMA_SHIFT_MAX)) {
+        return false;
+    }
+
+    cfgOptions.psuFilter.mode[channel] = mode;
+    cfgOptions.psuFilter.emaShift[channel] = emaShift;
+    psuFilters[channel].bPrimed = false;
+
+    return true;
+}
 
-    ensures \forall int i; 0 <= i <= 3 ==>
+/*@
+    assigns psuStates[0 .. PSU_COUNT-1].limitMode;
+    assigns psuStates[0 .. PSU_COUNT-1].realV;
+    assigns psuStates[0 .. PSU_COUNT-1].realI;
+    assigns psuStates[0 .. PSU_COUNT-1].rawV;
+    assigns psuStates[0 .. PSU_COUNT-1].rawI;
+    assigns psuFilters[0 .. PSU_FILTER_CHANNELS-1];
+    assigns psuFilterLastSequence;
+
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
         ((psuStates[i].limitMode == psuLimit_Voltage) || (psuStates[i].limitMode == psuLimit_Current))
-        && (psuStates[i].realV == currentADC[i * 2])
-        && (psuStates[i].realI == currentADC[i * 2 + 1]);
+        && (psuStates[i].realV < (1 << ADC_OVERSAMPLED_BITS))
+        && (psuStates[i].realI < (1 << ADC_OVERSAMPLED_BITS));
 */
 void psuUpdateMeasuredState() {
-    psuStates[0].limitMode = ((PINA & 0x04) == 0) ? psuLimit_Voltage : psuLimit_Current;
-    psuStates[0].realV = currentADC[0];
-    psuStates[0].realI = currentADC[1];
+    /*
+        Voltages and currents are taken from a single consistent ADC block
+        so V and I of every PSU always originate from the same scan
+    */
+    struct adcSnapshot snap;
+    enum limitingMode oldLimitMode[PSU_COUNT];
+    uint8_t pinState[PSU_PORTS];
+    bool bNewBlock;
+    uint8_t i;
+
+    adcGetSnapshot(&snap);
+    bNewBlock = (snap.sequence != psuFilterLastSequence) ? true : false;
+    psuFilterLastSequence = snap.sequence;
+
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        oldLimitMode[i] = psuStates[i].limitMode;
+    }
+
+    psuPortReadPins(pinState);
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        psuStates[i].limitMode = ((pinState[psuDescriptors[i].port] & psuDescriptors[i].limitMask) == 0) ? psuLimit_Voltage : psuLimit_Current;
+    }
 
-    psuStates[1].limitMode = ((PINA & 0x40) == 0) ? psuLimit_Voltage : psuLimit_Current;
-    psuStates[1].realV = currentADC[2];
-    psuStates[1].realI = currentADC[3];
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        psuStates[i].rawV = snap.values[psuDescriptors[i].adcVoltage];
+        psuStates[i].rawI = snap.values[psuDescriptors[i].adcCurrent];
 
-    psuStates[2].limitMode = ((PINC & 0x20) == 0) ? psuLimit_Voltage : psuLimit_Current;
-    psuStates[2].realV = currentADC[4];
-    psuStates[2].realI = currentADC[5];
+        if(bNewBlock == true) {
+            psuStates[i].realV = psuFilterApply((i << 1), snap.values[psuDescriptors[i].adcVoltage]);
+            psuStates[i].realI = psuFilterApply((i << 1) + 1, snap.values[psuDescriptors[i].adcCurrent]);
+        }
+    }
 
-    psuStates[3].limitMode = ((PINC & 0x02) == 0) ? psuLimit_Voltage : psuLimit_Current;
-    psuStates[3].realV = currentADC[6];
-    psuStates[3].realI = currentADC[7];
+    /* A PSU entering or leaving current limit freezes an armed ADC trace */
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        if(oldLimitMode[i] != psuStates[i].limitMode) {
+            adcTraceTrigger(ADC_TRACE_SOURCE_LIMITMODE);
+        }
+    }
 }
 
 /*@
-    requires \forall int i; 0 < i < 3 ==>
+    requires \forall int i; 0 <= i < PSU_COUNT ==>
         ((psuStates[i].bOutputEnable == true) || (psuStates[i].bOutputEnable == false))
         && ((psuStates[i].polPolarity == psuPolarity_Positive) || (psuStates[i].polPolarity == psuPolarity_Negative));
 
     assigns PORTA;
     assigns PORTC;
+    assigns PORTG;
+    assigns PORTE;
 
-    ensures ((PORTA & 0x01) == 0x01) && (psuStates[0].bOutputEnable == true) || (((PORTA & 0x01) == 0) && (psuStates[0].bOutputEnable != true));
-    ensures ((PORTA & 0x10) == 0x10) && (psuStates[1].bOutputEnable == true) || (((PORTA & 0x10) == 0) && (psuStates[1].bOutputEnable != true));
-    ensures ((PORTC & 0x80) == 0x80) && (psuStates[2].bOutputEnable == true) || (((PORTC & 0x80) == 0) && (psuStates[2].bOutputEnable != true));
-    ensures ((PORTC & 0x08) == 0x08) && (psuStates[3].bOutputEnable == true) || (((PORTC & 0x08) == 0) && (psuStates[3].bOutputEnable != true));
-
-    ensures ((PORTA & 0x02) == 0x02) && (psuStates[0].polPolarity != psuPolarity_Positive) || (((PORTA & 0x02) == 0) && (psuStates[0].polPolarity == psuPolarity_Positive));
-    ensures ((PORTA & 0x20) == 0x20) && (psuStates[1].polPolarity != psuPolarity_Positive) || (((PORTA & 0x20) == 0) && (psuStates[1].polPolarity == psuPolarity_Positive));
-    ensures ((PORTC & 0x40) == 0x40) && (psuStates[2].polPolarity != psuPolarity_Positive) || (((PORTC & 0x40) == 0) && (psuStates[2].polPolarity == psuPolarity_Positive));
-    ensures ((PORTC & 0x04) == 0x04) && (psuStates[2].polPolarity != psuPolarity_Positive) || (((PORTC & 0x04) == 0) && (psuStates[2].polPolarity == psuPolarity_Positive));
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
+        (((acsl_psu_port(psuDescriptors[i].port) & psuDescriptors[i].enableMask) != 0) <==> (psuStates[i].bOutputEnable == true));
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
+        (((acsl_psu_port(psuDescriptors[i].port) & psuDescriptors[i].polarityMask) != 0) <==> (psuStates[i].polPolarity != psuPolarity_Positive));
 */
 void psuSetOutputs() {
-    uint8_t currentPortA = PORTA;
-    uint8_t currentPortC = PORTC;
-
+    uint8_t portBits[PSU_PORTS];
+    uint8_t current;
     uint8_t i;
+    uint8_t sregOld = SREG;
 
-    /*@
-        loop invariant 0 < i < 5;
-        loop assigns currentPortA;
-        loop assigns currentPortC;
-        loop variant 4-i;
+    /*
+        Ports are only written if a bit differs. Done with interrupts
+        disabled so an emergency disable from the ADC ISR can not be
+        overwritten by a stale read-modify-write
     */
-    for(i = 0; i < 4; i=i+1) {
-        switch(i) {
-            case 0:
-            {
-                if(psuStates[0].bOutputEnable == true) {
-                    currentPortA = currentPortA | 0x01;
-                } else {
-                    currentPortA = currentPortA & (~(0x01));
-                }
-
-                if(psuStates[0].polPolarity == psuPolarity_Positive) {
-                    currentPortA = currentPortA & (~(0x02));
-                } else {
-                    currentPortA = currentPortA | 0x02;
-                }
-                break;
-            }
-            case 1:
-            {
-                if(psuStates[1].bOutputEnable == true) {
-                    currentPortA = currentPortA | 0x10;
-                } else {
-                    currentPortA = currentPortA & (~(0x10));
-                }
-
-                if(psuStates[1].polPolarity == psuPolarity_Positive) {
-                    currentPortA = currentPortA & (~(0x20));
-                } else {
-                    currentPortA = currentPortA | 0x20;
-                }
-                break;
-            }
-            case 2:
-            {
-                if(psuStates[2].bOutputEnable == true) {
-                    currentPortC = currentPortC | 0x80;
-                } else {
-                    currentPortC = currentPortC & (~(0x80));
-                }
-
-                if(psuStates[2].polPolarity == psuPolarity_Positive) {
-                    currentPortC = currentPortC & (~(0x40));
-                } else {
-                    currentPortC = currentPortC | 0x40;
-                }
-                break;
-            }
-            case 3:
-            {
-                if(psuStates[3].bOutputEnable == true) {
-                    currentPortC = currentPortC | 0x08;
-                } else {
-                    currentPortC = currentPortC & (~(0x08));
-                }
-
-                if(psuStates[3].polPolarity == psuPolarity_Positive) {
-                    currentPortC = currentPortC & (~(0x04));
-                } else {
-                    currentPortC = currentPortC | 0x04;
-                }
-                break;
-            }
-            default:
-                return;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    for(i = 0; i < PSU_PORTS; i=i+1) {
+        portBits[i] = 0;
+    }
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        portBits[psuDescriptors[i].port] = portBits[psuDescriptors[i].port] | psuOutputBits(i);
+    }
+
+    for(i = 0; i < PSU_PORTS; i=i+1) {
+        current = psuPortRead(i);
+        if((current & psuPortOutputMask[i]) != portBits[i]) {
+            psuPortWrite(i, (current & (~psuPortOutputMask[i])) | portBits[i]);
         }
     }
 
-    PORTA = currentPortA;
-    PORTC = currentPortC;
+    SREG = sregOld;
 }
 
 /*@
-    requires (psuIndex >= 0) && (psuIndex < 4);
-    requires \forall int i; 0 < i < 3 ==>
+    requires (psuIndex >= 0) && (psuIndex < PSU_COUNT);
+    requires \forall int i; 0 <= i < PSU_COUNT ==>
         ((psuStates[i].bOutputEnable == true) || (psuStates[i].bOutputEnable == false))
         && ((psuStates[i].polPolarity == psuPolarity_Positive) || (psuStates[i].polPolarity == psuPolarity_Negative));
 
     assigns PORTA;
     assigns PORTC;
+    assigns PORTG;
+    assigns PORTE;
+
+    ensures ((acsl_psu_port(psuDescriptors[psuIndex].port) & psuDescriptors[psuIndex].enableMask) != 0) <==> (psuStates[psuIndex].bOutputEnable == true);
+    ensures ((acsl_psu_port(psuDescriptors[psuIndex].port) & psuDescriptors[psuIndex].polarityMask) != 0) <==> (psuStates[psuIndex].polPolarity != psuPolarity_Positive);
 */
 void psuSetOutput(int psuIndex) {
-    uint8_t currentPortA = PORTA;
-    uint8_t currentPortC = PORTC;
-
-    switch(psuIndex) {
-        case 0:
-        {
-            if(psuStates[0].bOutputEnable == true) {
-                currentPortA = currentPortA | 0x01;
-            } else {
-                currentPortA = currentPortA & (~(0x01));
-            }
+    uint8_t port;
+    uint8_t mask;
+    uint8_t current;
+    uint8_t sregOld;
 
-            if(psuStates[0].polPolarity == psuPolarity_Positive) {
-                currentPortA = currentPortA & (~(0x02));
-            } else {
-                currentPortA = currentPortA | 0x02;
-            }
-            break;
-        }
-        case 1:
-        {
-            if(psuStates[1].bOutputEnable == true) {
-                currentPortA = currentPortA | 0x10;
-            } else {
-                currentPortA = currentPortA & (~(0x10));
-            }
+    if((psuIndex < 0) || (psuIndex >= PSU_COUNT)) {
+        return;
+    }
+    port = psuDescriptors[psuIndex].port;
+    mask = psuDescriptors[psuIndex].enableMask | psuDescriptors[psuIndex].polarityMask;
 
-            if(psuStates[1].polPolarity == psuPolarity_Positive) {
-                currentPortA = currentPortA & (~(0x20));
-            } else {
-                currentPortA = currentPortA | 0x20;
-            }
-            break;
-        }
-        case 2:
-        {
-            if(psuStates[2].bOutputEnable == true) {
-                currentPortC = currentPortC | 0x80;
-            } else {
-                currentPortC = currentPortC & (~(0x80));
-            }
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    current = psuPortRead(port);
+    if((current & mask) != psuOutputBits(psuIndex)) {
+        psuPortWrite(port, (current & (~mask)) | psuOutputBits(psuIndex));
+    }
+    SREG = sregOld;
+}
 
-            if(psuStates[2].polPolarity == psuPolarity_Positive) {
-                currentPortC = currentPortC & (~(0x40));
-            } else {
-                currentPortC = currentPortC | 0x40;
-            }
-            break;
-        }
-        case 3:
-        {
-            if(psuStates[3].bOutputEnable == true) {
-                currentPortC = currentPortC | 0x08;
-            } else {
-                currentPortC = currentPortC & (~(0x08));
-            }
+/*
+    Disables all PSU outputs immediately (used by the overcurrent trip in
+    the ADC ISR, has to be called with interrupts disabled)
+*/
+/*@
+    assigns PORTA;
+    assigns PORTC;
+    assigns PORTG;
+    assigns PORTE;
+    assigns psuStates[0 .. PSU_COUNT-1].bOutputEnable;
 
-            if(psuStates[3].polPolarity == psuPolarity_Positive) {
-                currentPortC = currentPortC & (~(0x04));
-            } else {
-                currentPortC = currentPortC | 0x04;
-            }
-            break;
-        }
-        default:
-            return;
-    }
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
+        ((acsl_psu_port(psuDescriptors[i].port) & psuDescriptors[i].enableMask) == 0);
+*/
+void psuEmergencyDisable() {
+    uint8_t i;
 
-    PORTA = currentPortA;
-    PORTC = currentPortC;
+    /* Straight from the table so this works even before psuInit */
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        psuPortWrite(psuDescriptors[i].port, psuPortRead(psuDescriptors[i].port) & (~(psuDescriptors[i].enableMask)));
+        psuStates[i].bOutputEnable = false;
+    }
 }
 
 /*@
     assigns SREG;
     assigns DDRA;
     assigns DDRC;
+    assigns DDRG;
+    assigns DDRE;
     assigns DDRL;
+    assigns DDRH;
     assigns DDRD;
     assigns PORTA;
     assigns PORTC;
+    assigns PORTG;
+    assigns PORTE;
     assigns PORTL;
+    assigns PORTH;
     assigns PORTD;
 
-    assigns psuStates[0 .. 3].bOutputEnable;
-    assigns psuStates[0 .. 3].polPolarity;
-    assigns psuStates[0 .. 3].setVTarget;
-    assigns psuStates[0 .. 3].setILimit;
+    assigns psuStates[0 .. PSU_COUNT-1].bOutputEnable;
+    assigns psuStates[0 .. PSU_COUNT-1].polPolarity;
+    assigns psuStates[0 .. PSU_COUNT-1].setVTarget;
+    assigns psuStates[0 .. PSU_COUNT-1].setILimit;
 
-    ensures \forall int i; 0 < i < 3 ==>
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
         (psuStates[i].bOutputEnable == false)
-        && (psuStates[i].polPolarity == psuPolarity_Negative)
+        && (psuStates[i].polPolarity == psuDescriptors[i].polInitial)
         && (psuStates[i].setVTarget == 0)
         && (psuStates[i].setILimit == 0);
-    ensures (psuStates[3].bOutputEnable == false)
-        && (psuStates[3].setVTarget == 0)
-        && (psuStates[3].setILimit == 0)
-        && (psuStates[3].polPolarity == psuPolarity_Positive);
 */
 void psuInit() {
     unsigned long int i;
+    uint8_t portBits[PSU_PORTS];
     uint8_t oldSREG = SREG;
 
     #ifndef FRAMAC_SKIP
         cli();
     #endif
 
-    DDRA = 0x33;    PORTA = 0x22;
-    DDRC = 0xCC;    PORTC = 0x40;
-    DDRL = 0xFF;    PORTL = 0x00;
-    DDRD = 0x80;    PORTD = 0x00;
+    for(i = 0; i < PSU_PORTS; i=i+1) {
+        psuPortOutputMask[i] = 0;
+        psuPortLimitMask[i] = 0;
+    }
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        psuPortOutputMask[psuDescriptors[i].port] = psuPortOutputMask[psuDescriptors[i].port] | psuDescriptors[i].enableMask | psuDescriptors[i].polarityMask;
+        psuPortLimitMask[psuDescriptors[i].port] = psuPortLimitMask[psuDescriptors[i].port] | psuDescriptors[i].limitMask;
 
-    /* Set PSU states structures */
-    for(i = 0; i < 3; i=i+1) {
+        psuLimitLatches[i].count = 0;
+        psuLimitLatches[i].entryMicros = 0;
+        psuLimitLatches[i].exitMicros = 0;
+    }
+    psuPortReadPins(psuLimitLastPins);
+    psuLimitEventMask = 0;
+
+    /* Set PSU states structures - outputs disabled, initial polarity */
+    for(i = 0; i < PSU_PORTS; i=i+1) {
+        portBits[i] = 0;
+    }
+    for(i = 0; i < PSU_COUNT; i=i+1) {
         psuStates[i].bOutputEnable      = false;
-        psuStates[i].polPolarity        = psuPolarity_Negative;
+        psuStates[i].polPolarity        = psuDescriptors[i].polInitial;
         psuStates[i].setVTarget         = 0;
         psuStates[i].setILimit          = 0;
+
+        portBits[psuDescriptors[i].port] = portBits[psuDescriptors[i].port] | psuOutputBits(i);
     }
 
-    psuStates[3].bOutputEnable      = false;
-    psuStates[3].polPolarity        = psuPolarity_Positive;
-    psuStates[3].setVTarget         = 0;
-    psuStates[3].setILimit          = 0;
+    DDRA = psuPortOutputMask[PSU_PORT_A];   PORTA = portBits[PSU_PORT_A];
+    DDRC = psuPortOutputMask[PSU_PORT_C];   PORTC = portBits[PSU_PORT_C];
+    #if PSU_PORTS > 2
+        /* Shared with other functions, only the PSU pins are touched */
+        DDRG = (DDRG & (~psuPortLimitMask[PSU_PORT_G])) | psuPortOutputMask[PSU_PORT_G];
+        PORTG = (PORTG & (~psuPortOutputMask[PSU_PORT_G])) | portBits[PSU_PORT_G];
+    #endif
+    #if PSU_PORTS > 3
+        DDRE = (DDRE & (~psuPortLimitMask[PSU_PORT_E])) | psuPortOutputMask[PSU_PORT_E];
+        PORTE = (PORTE & (~psuPortOutputMask[PSU_PORT_E])) | portBits[PSU_PORT_E];
+    #endif
+    DDRL = 0xFF;    PORTL = 0x00;
+    #if PWMOUT_CHANNELS > 8
+        DDRH = DDRH | PWMOUT_PORTH_PINS;    PORTH = PORTH & (~PWMOUT_PORTH_PINS);
+    #endif
+    DDRD = 0x80;    PORTD = 0x00;
+
+    /* Validate filter configuration, unknown settings disable filtering */
+    for(i = 0; i < PSU_FILTER_CHANNELS; i=i+1) {
+        if(psuFilterConfigure(i, cfgOptions.psuFilter.mode[i], cfgOptions.psuFilter.emaShift[i]) != true) {
+            psuFilterConfigure(i, PSU_FILTER_NONE, 0);
+        }
+    }
 
     SREG = oldSREG;
 
-    /* We just wait for around 2 ms till all analog measurements are done ... */
-    delay(2);
+    /* We just wait till the first complete block of analog measurements is done ... */
+    adcWaitSettled();
+    psuFilterLastSequence = adcGetSequence() - 1;
 
     psuUpdateMeasuredState();
 }
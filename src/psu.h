@@ -9,6 +9,30 @@
     #endif
 #endif
 
+/*
+    Number of HCP supplies
+
+        Every PSU n (0 ... PSU_COUNT-1) owns the logical channels 2n
+        (voltage) and 2n+1 (current) used for calibration, filtering and
+        the PWM setpoints. Which ADC input, PWM channel and port pins belong
+        to a PSU is kept in the descriptor table psuDescriptors. PSUs 1 ... 4
+        are the electron gun supplies driven by the ramps, additional PSUs
+        (e.g. deflectors) would only be set by commands. Every PSU needs two
+        PWM channels (PWMOUT_CHANNELS) and two ADC inputs (ADC_CHANNEL_COUNT).
+
+        PSU_COUNT 5 and 6 (make PSUCOUNT=6) add a second deflector pair on
+        the otherwise unused pins of ports G, E, H and K (see README). There
+        are no free pins for more supplies.
+*/
+#ifndef PSU_COUNT
+    #define PSU_COUNT               4
+#endif
+#define PSU_CHANNELS                (2 * PSU_COUNT)
+
+#if (PSU_COUNT < 4) || (PSU_COUNT > 6)
+    #error PSU_COUNT has to be 4 ... 6 (the gun supplies plus up to two deflectors)
+#endif
+
 enum psuPolarity {
     psuPolarity_Positive,
     psuPolarity_Negative
@@ -19,100 +43,215 @@ enum limitingMode {
     psuLimit_Voltage
 };
 
+/*
+    Filter stage applied to realV / realI. Filter channels are 2*PSU for
+    voltage and 2*PSU+1 for current
+*/
+#define PSU_FILTER_CHANNELS         PSU_CHANNELS
+#define PSU_FILTER_EMA_SHIFT_MAX    8
+
+#define PSU_FILTER_NONE             0
+#define PSU_FILTER_EMA              1
+#define PSU_FILTER_MEDIAN3          2
+#define PSU_FILTER_MEDIAN5          3
+
 struct psuState {
     bool                    bOutputEnable;
     enum psuPolarity        polPolarity;
     uint16_t                setVTarget;
     uint16_t                setILimit;
 
-    /* Sensing */
+    /* Sensing (readings keep the full ADC_OVERSAMPLED_BITS resolution) */
     enum limitingMode       limitMode;
-    uint16_t                realV;
+    uint16_t                realV;      /* Filtered (used for reporting) */
     uint16_t                realI;
+    uint16_t                rawV;       /* Unfiltered (used for protection) */
+    uint16_t                rawI;
     #if 0
         enum psuPolarity        realPolarity;
     #endif
 };
 
+/*
+    PSU descriptor
+
+        Pin masks refer to the port selected by port (PSU_PORT_*): enable
+        and polarity are outputs, the limit sense is read from the matching
+        PIN register. Nominal transfer values are used for the defaults of
+        the calibration (cfgeepromDefaults). Roles (PSU_ROLE_*) select the
+        supplies the wehnelt / cathode clamp and blanking work on, each
+        role has to be given to exactly one PSU.
+*/
+#define PSU_PORT_A                  0
+#define PSU_PORT_C                  1
+#define PSU_PORT_G                  2
+#define PSU_PORT_E                  3
+#if PSU_COUNT > 5
+    #define PSU_PORTS               4
+#elif PSU_COUNT > 4
+    #define PSU_PORTS               3
+#else
+    #define PSU_PORTS               2
+#endif
+
+#define PSU_ROLE_NONE               0x00
+#define PSU_ROLE_CATHODE            0x01    /* Clamp reference, blanking only while its setpoint is not zero */
+#define PSU_ROLE_WEHNELT            0x02    /* Clamped to the cathode, switched by blanking */
+
+struct psuDescriptor {
+    uint8_t                     adcVoltage;     /* ADC input of the voltage readout */
+    uint8_t                     adcCurrent;     /* ADC input of the current readout */
+    uint8_t                     pwmVoltage;     /* PWM channel of the voltage setpoint */
+    uint8_t                     pwmCurrent;     /* PWM channel of the current limit */
+
+    uint8_t                     port;
+    uint8_t                     enableMask;
+    uint8_t                     polarityMask;   /* Set for negative polarity */
+    uint8_t                     limitMask;      /* Set while current limiting */
+    enum psuPolarity            polInitial;
+    uint8_t                     roles;
+
+    double                      adcVoltsPerCount;
+    double                      adcTenthMicroampsPerCount;
+    double                      pwmVoltsPerOnCycle;
+    double                      pwmMicroampsPerOnCycle;
+};
+
 #ifdef __cplusplus
     extern "C" {
 #endif
 
-extern struct psuState psuStates[4];
+extern const struct psuDescriptor psuDescriptors[PSU_COUNT];
+extern struct psuState psuStates[PSU_COUNT];
+
+/*@
+    logic integer acsl_psu_port(integer port) =
+        (port == PSU_PORT_A) ? PORTA :
+        (port == PSU_PORT_C) ? PORTC :
+        (port == PSU_PORT_G) ? PORTG : PORTE;
+*/
 
 /*@
     assigns SREG;
     assigns DDRA;
     assigns DDRC;
+    assigns DDRG;
+    assigns DDRE;
     assigns DDRL;
+    assigns DDRH;
     assigns DDRD;
     assigns PORTA;
     assigns PORTC;
+    assigns PORTG;
+    assigns PORTE;
     assigns PORTL;
+    assigns PORTH;
     assigns PORTD;
 
-    assigns psuStates[0 .. 3].bOutputEnable;
-    assigns psuStates[0 .. 3].polPolarity;
-    assigns psuStates[0 .. 3].setVTarget;
-    assigns psuStates[0 .. 3].setILimit;
+    assigns psuStates[0 .. PSU_COUNT-1].bOutputEnable;
+    assigns psuStates[0 .. PSU_COUNT-1].polPolarity;
+    assigns psuStates[0 .. PSU_COUNT-1].setVTarget;
+    assigns psuStates[0 .. PSU_COUNT-1].setILimit;
 
-    ensures \forall int i; 0 < i < 3 ==>
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
         (psuStates[i].bOutputEnable == false)
-        && (psuStates[i].polPolarity == psuPolarity_Negative)
+        && (psuStates[i].polPolarity == psuDescriptors[i].polInitial)
         && (psuStates[i].setVTarget == 0)
         && (psuStates[i].setILimit == 0);
-    ensures (psuStates[3].bOutputEnable == false)
-        && (psuStates[3].setVTarget == 0)
-        && (psuStates[3].setILimit == 0)
-        && (psuStates[3].polPolarity == psuPolarity_Positive);
 */
 void psuInit();
 
 /*@
-    requires (psuIndex >= 0) && (psuIndex < 4);
-    requires \forall int i; 0 < i < 3 ==>
+    requires (psuIndex >= 0) && (psuIndex < PSU_COUNT);
+    requires \forall int i; 0 <= i < PSU_COUNT ==>
         ((psuStates[i].bOutputEnable == true) || (psuStates[i].bOutputEnable == false))
         && ((psuStates[i].polPolarity == psuPolarity_Positive) || (psuStates[i].polPolarity == psuPolarity_Negative));
 
     assigns PORTA;
     assigns PORTC;
+    assigns PORTG;
+    assigns PORTE;
+
+    ensures ((acsl_psu_port(psuDescriptors[psuIndex].port) & psuDescriptors[psuIndex].enableMask) != 0) <==> (psuStates[psuIndex].bOutputEnable == true);
+    ensures ((acsl_psu_port(psuDescriptors[psuIndex].port) & psuDescriptors[psuIndex].polarityMask) != 0) <==> (psuStates[psuIndex].polPolarity != psuPolarity_Positive);
 */
 void psuSetOutput(int psuIndex);
 
 /*@
-    requires \forall int i; 0 < i < 3 ==>
+    requires \forall int i; 0 <= i < PSU_COUNT ==>
         ((psuStates[i].bOutputEnable == true) || (psuStates[i].bOutputEnable == false))
         && ((psuStates[i].polPolarity == psuPolarity_Positive) || (psuStates[i].polPolarity == psuPolarity_Negative));
 
     assigns PORTA;
     assigns PORTC;
+    assigns PORTG;
+    assigns PORTE;
 
-    ensures ((PORTA & 0x01) == 0x01) && (psuStates[0].bOutputEnable == true) || (((PORTA & 0x01) == 0) && (psuStates[0].bOutputEnable != true));
-    ensures ((PORTA & 0x10) == 0x10) && (psuStates[1].bOutputEnable == true) || (((PORTA & 0x10) == 0) && (psuStates[1].bOutputEnable != true));
-    ensures ((PORTC & 0x80) == 0x80) && (psuStates[2].bOutputEnable == true) || (((PORTC & 0x80) == 0) && (psuStates[2].bOutputEnable != true));
-    ensures ((PORTC & 0x08) == 0x08) && (psuStates[3].bOutputEnable == true) || (((PORTC & 0x08) == 0) && (psuStates[3].bOutputEnable != true));
-
-    ensures ((PORTA & 0x02) == 0x02) && (psuStates[0].polPolarity != psuPolarity_Positive) || (((PORTA & 0x02) == 0) && (psuStates[0].polPolarity == psuPolarity_Positive));
-    ensures ((PORTA & 0x20) == 0x20) && (psuStates[1].polPolarity != psuPolarity_Positive) || (((PORTA & 0x20) == 0) && (psuStates[1].polPolarity == psuPolarity_Positive));
-    ensures ((PORTC & 0x40) == 0x40) && (psuStates[2].polPolarity != psuPolarity_Positive) || (((PORTC & 0x40) == 0) && (psuStates[2].polPolarity == psuPolarity_Positive));
-    ensures ((PORTC & 0x04) == 0x04) && (psuStates[2].polPolarity != psuPolarity_Positive) || (((PORTC & 0x04) == 0) && (psuStates[2].polPolarity == psuPolarity_Positive));
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
+        (((acsl_psu_port(psuDescriptors[i].port) & psuDescriptors[i].enableMask) != 0) <==> (psuStates[i].bOutputEnable == true));
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
+        (((acsl_psu_port(psuDescriptors[i].port) & psuDescriptors[i].polarityMask) != 0) <==> (psuStates[i].polPolarity != psuPolarity_Positive));
 */
 void psuSetOutputs();
 
+/*
+    Clears all output enable pins immediately. Interrupts have to be
+    disabled (used from the ADC overcurrent trip)
+*/
+void psuEmergencyDisable();
+
 /*@
-    assigns psuStates[0 .. 3].limitMode;
-    assigns psuStates[0 .. 3].realV;
-    assigns psuStates[0 .. 3].realI;
+    assigns psuStates[0 .. PSU_COUNT-1].limitMode;
+    assigns psuStates[0 .. PSU_COUNT-1].realV;
+    assigns psuStates[0 .. PSU_COUNT-1].realI;
+    assigns psuStates[0 .. PSU_COUNT-1].rawV;
+    assigns psuStates[0 .. PSU_COUNT-1].rawI;
 
-    ensures \forall int i; 0 <= i <= 3 ==>
+    ensures \forall int i; 0 <= i < PSU_COUNT ==>
         ((psuStates[i].limitMode == psuLimit_Voltage) || (psuStates[i].limitMode == psuLimit_Current))
         && (psuStates[i].realV >= 0)
-        && (psuStates[i].realV < 1024)
+        && (psuStates[i].realV < 8192)
         && (psuStates[i].realI >= 0)
-        && (psuStates[i].realI < 1024);
+        && (psuStates[i].realI < 8192);
 */
 void psuUpdateMeasuredState();
 
+/*
+    Current limit latch
+
+        The limit sense lines (PA2, PA6, PC5, PC1 with the default
+        descriptors) have no pin change interrupt on the ATmega2560, so
+        psuLimitSample is called by the PWM timer ISR every tick (48 us)
+        and latches every transition between voltage and current
+        regulation with a micros() timestamp. Short excursions between two
+        main loop iterations are not lost anymore and detection latency is
+        bounded by one tick.
+*/
+struct psuLimitLatch {
+    unsigned long int       count;          /* Transitions into current limit */
+    unsigned long int       entryMicros;    /* Last transition into current limit */
+    unsigned long int       exitMicros;     /* Last transition back into voltage regulation */
+};
+
+/*
+    Called from the timer ISR (interrupts disabled)
+*/
+void psuLimitSample();
+
+/*
+    Returns the PSUs (bit n: PSU n) that entered current limit since the
+    last call
+*/
+uint8_t psuLimitFetchEvents();
+
+bool psuLimitGetLatch(uint8_t psuIndex, struct psuLimitLatch* lpOut);
+
+/*
+    Selects the filter (PSU_FILTER_*) and EMA shift (alpha = 2^-shift) of a
+    filter channel and restarts it. The setting is kept in cfgOptions
+*/
+bool psuFilterConfigure(uint8_t channel, uint8_t mode, uint8_t emaShift);
+
 #ifdef __cplusplus
     } /* extern "C" { */
 #endif
@@ -2,11 +2,6 @@
 #include <avr/interrupt.h>
 #include <stdint.h>
 
-#define PWM_VPERDIVK (3.24781922941*0.899405351856)
-#define PWM_VPERDIVW (3.49231230262*0.899009900992)
-#define PWM_VPERDIVFOC 3.137850885
-#define PWM_VPERDIV4 3.1914893617
-#define PWM_VPERUA 0.979959039479
 #define PWM_FILA_VPERDIV 0.224609375
 
 // V / PWM_VPERDIVK
@@ -17,12 +12,21 @@
 #define PWM_MAX_DIFFERENCE_W_K_PV 100
 #define PWM_MAX_DIFFERENCE_W_K_NV 15
 
-#define VMAXSLOPE_V_PER_S 12
-
 #include "./sysclock.h"
 #include "./pwmout.h"
 #include "./psu.h"
 #include "./serial.h"
+#include "./cfgeeprom.h"
+#include "./adc.h"
+
+/*
+    Wehnelt / cathode clamp in wehnelt PWM counts (Q16): cathode counts
+    are converted by PWM_VPERDIVK / PWM_VPERDIVW, the voltage limits by
+    1 / PWM_VPERDIVW. All evaluated at compile time
+*/
+#define PWM_RATIO_K_W_Q16 ((uint32_t)((PWM_VPERDIVK / PWM_VPERDIVW) * 65536.0 + 0.5))
+#define PWM_MAX_DIFFERENCE_W_K_PV_Q16 ((uint32_t)((PWM_MAX_DIFFERENCE_W_K_PV / PWM_VPERDIVW) * 65536.0 + 0.5))
+#define PWM_MAX_DIFFERENCE_W_K_NV_Q16 ((uint32_t)((PWM_MAX_DIFFERENCE_W_K_NV / PWM_VPERDIVW) * 65536.0 + 0.5))
 
 #ifdef __cplusplus
     extern "C" {
@@ -47,36 +51,547 @@
 #define PWM_TIMERTICK_PRESCALER             0x06
 #define PWM_TIMERTICK_OVERFLOWVAL           0x02
 
-static uint16_t pwmoutOnCyclesReal[8];
-uint16_t pwmoutOnCycles[8];
-static uint16_t pwmoutCurrentCycles[8];
+/*
+    PWM profiles (see pwmout.h). The tick is OCR2A + 1 counts of 16 us
+    (prescaler 256). The slope update runs when the free running 16 bit
+    slopeUpdateInterval counter passes 2048, i.e. once per 65536 ticks
+*/
+struct pwmoutProfile {
+    uint8_t                     bits;
+    uint8_t                     overflowVal;
+    uint8_t                     tickMicros;
+};
+
+static const struct pwmoutProfile pwmoutProfiles[PWMOUT_PROFILE_COUNT] = {
+    { 10, PWM_TIMERTICK_OVERFLOWVAL, 48 },
+    {  8, PWM_TIMERTICK_OVERFLOWVAL, 48 },
+    { 12, PWM_TIMERTICK_OVERFLOWVAL, 48 },
+    { 10, 0x01, 32 }
+};
+
+#define PWMOUT_SLOPE_UPDATE_TICKS           65536UL
+
+static uint8_t pwmoutProfileActive;
+static uint16_t pwmoutPeriodMask;           /* Last tick of a period */
+
+static uint16_t pwmoutOnCyclesReal[PWMOUT_CHANNELS];
+uint16_t pwmoutOnCycles[PWMOUT_CHANNELS];
 static bool bFilamentOn;
 
+/*
+    Output pins of the PWM channels: PORTL in the low byte (channel 0 is
+    PL7 ... channel 6 is PL1), PORTH in the high byte (channel 8 is PH3
+    ... channel 11 is PH6). Channels without pin are never generated, this
+    is channel 7 (PL0 is never driven). Loops over generated channels stop
+    at PWMOUT_CHANNELS_DRIVEN.
+*/
+#if PWMOUT_CHANNELS > 8
+    #define PWMOUT_CHANNELS_DRIVEN PWMOUT_CHANNELS
+#else
+    #define PWMOUT_CHANNELS_DRIVEN 7
+#endif
+static const pwmoutMask pwmoutChannelPin[PWMOUT_CHANNELS] = {
+    0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x00
+    #if PWMOUT_CHANNELS > 8
+        , 0x0800, 0x1000
+    #endif
+    #if PWMOUT_CHANNELS > 10
+        , 0x2000, 0x4000
+    #endif
+};
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns \nothing;
+*/
+static inline bool pwmoutChannelDriven(
+    uint8_t channel
+) {
+    return ((channel < PWMOUT_CHANNELS_DRIVEN) && (pwmoutChannelPin[channel] != 0)) ? true : false;
+}
+
+/*
+    Timer 5 hardware PWM
+
+        OC5A, OC5B and OC5C are the only compare outputs routed to PORTL
+        (PL3, PL4 and PL5 - channels 4, 3 and 2). With PWMOUT_HWTIMER5
+        these channels are generated by timer 5 in 10 bit fast PWM mode and
+        removed from the software schedule. Note that this raises their
+        PWM frequency from about 20 Hz to 15.6 kHz which changes ripple
+        after the analog filter. All other channels have to stay in
+        software since their pins have no compare output.
+*/
+#ifdef PWMOUT_HWTIMER5
+    #define PWMOUT_PORTL_SOFTWARE_PINS (0xFE & ~(0x38))
+#else
+    #define PWMOUT_PORTL_SOFTWARE_PINS 0xFE
+#endif
+#if PWMOUT_CHANNELS > 8
+    #define PWMOUT_SOFTWARE_PINS (PWMOUT_PORTL_SOFTWARE_PINS | (PWMOUT_PORTH_PINS << 8))
+#else
+    #define PWMOUT_SOFTWARE_PINS PWMOUT_PORTL_SOFTWARE_PINS
+#endif
+
+/*
+    Software PWM schedule
+
+        Instead of comparing every channel on every tick the ISR walks a
+        precomputed schedule: All active software channels are set at the
+        start of the 1024 tick period (setMask), then the channels are
+        cleared in order of their on time (a single event per distinct on
+        time). Each tick therefore needs at most one compare and one
+        PORTL (and PORTH) write.
+
+        Schedules are double buffered - a new schedule is built into the
+        inactive buffer and activated at the next period boundary so a
+        period is never generated from mixed settings.
+*/
+struct pwmoutSchedule {
+    pwmoutMask                  setMask;
+    uint8_t                     eventCount;
+    uint16_t                    eventTick[PWMOUT_CHANNELS_DRIVEN];
+    pwmoutMask                  eventClearMask[PWMOUT_CHANNELS_DRIVEN];
+};
+
+static struct pwmoutSchedule pwmoutSchedules[2];
+static uint8_t pwmoutScheduleActive;
+static bool pwmoutSchedulePending;
+static uint16_t pwmoutTick;
+static uint8_t pwmoutNextEvent;
+static pwmoutMask pwmoutPortShadow;
+
+/*
+    Writes the software PWM pins: pins set in keepMask keep their state,
+    the others are replaced by bits. PORTH only carries channels in builds
+    with more than 8 channels
+*/
+/*@
+    assigns PORTL;
+    assigns PORTH;
+*/
+static inline void pwmoutPinsWrite(
+    pwmoutMask keepMask,
+    pwmoutMask bits
+) {
+    PORTL = (PORTL & (uint8_t)keepMask) | (uint8_t)bits;
+    #if PWMOUT_CHANNELS > 8
+        PORTH = (PORTH & (uint8_t)(keepMask >> 8)) | (uint8_t)(bits >> 8);
+    #endif
+}
+
+/*
+    Sigma-delta channels
+
+        The duty cycle is kept with 16 bit resolution: the 10 bit on
+        cycles extended by the fractional part supplied by setPSUVolts
+        and setPSUMicroamps (pwmoutOnFraction, 1/256 of a tick). Every
+        tick the duty is added to a 16 bit accumulator, the carry is the
+        output bit. Sigma-delta pins are never part of the PWM schedule.
+*/
+static uint8_t pwmoutOnFraction[PWMOUT_CHANNELS];
+static pwmoutMask pwmoutSigmaDeltaMask;
+static uint16_t pwmoutSigmaDeltaDuty[PWMOUT_CHANNELS];
+static uint16_t pwmoutSigmaDeltaAccu[PWMOUT_CHANNELS];
+
+/*
+    Closed loop trim state: Untrimmed setpoints of all channels and the
+    integral of every PSU, both in 1/256 on cycles. The slope update
+    counter lets the trim loop find out if a new setpoint has been applied
+*/
+static uint32_t pwmoutOnCyclesSetpoint[PWMOUT_CHANNELS];
+
+/*
+    Slopes of the piecewise linear table segments (Q16 on cycles per
+    unit), derived from cfgOptions.pwmout whenever the table changes
+*/
+static uint32_t pwmoutPwlSlope[PWMOUT_CHANNELS][PWMOUT_PWL_POINTS-1];
+static int32_t pwmoutTrimIntegral[PSU_COUNT];
+
+/*
+    Owner of every PWM channel, built from psuDescriptors in pwmoutInit:
+    the PSU index for voltage channels, the PSU index with
+    PWMOUT_CHANNEL_CURRENT for current channels
+*/
+#define PWMOUT_CHANNEL_CURRENT              0x80
+#define PWMOUT_CHANNEL_UNUSED               0xFF
+
+static uint8_t pwmoutChannelPSU[PWMOUT_CHANNELS];
+
+/*
+    Voltage channels of the PSUs with PSU_ROLE_CATHODE and PSU_ROLE_WEHNELT
+    (PWMOUT_CHANNEL_UNUSED disables the clamp and blanking)
+*/
+static uint8_t pwmoutChannelCathode;
+static uint8_t pwmoutChannelWehnelt;
+static uint8_t pwmoutTrimLastUpdate;
+static volatile uint8_t pwmoutSlopeUpdateCount;
+
+static void pwmoutApplyOnCycles(uint8_t channel);
+static bool pwmoutCalibrationPrepare(uint8_t channel);
+
+/*
+    Waveform player state. Points are stored as on cycles, converted
+    with the constants of the channel they have been uploaded for
+*/
+struct pwmoutWaveformPoint {
+    uint16_t                    onCycles;
+    uint16_t                    dwellTicks;
+    uint8_t                     channel;
+};
+
+struct pwmoutWaveformPlayer {
+    uint8_t                     state;
+    uint8_t                     first;
+    uint8_t                     count;
+    uint8_t                     index;
+    uint16_t                    loops;
+    uint16_t                    loopsLeft;
+    uint16_t                    dwellLeft;
+};
+
+/*
+    Staged setpoints (1/256 on cycles) and their values in volts or
+    microamps for psuStates. pwmoutCommitMask marks channels whose
+    setpoint has been committed but not yet applied by the ISR (bit n
+    is channel n)
+*/
+static uint32_t pwmoutStagedSetpoint[PWMOUT_CHANNELS];
+static uint16_t pwmoutStagedValue[PWMOUT_CHANNELS];
+static pwmoutMask pwmoutStagedMask;
+static volatile pwmoutMask pwmoutCommitMask;
+
+static struct pwmoutWaveformPoint pwmoutWaveformPoints[PWMOUT_WAVEFORM_POINTS];
+static struct pwmoutWaveformPlayer pwmoutWaveformPlayers[PWMOUT_CHANNELS];
+static pwmoutMask pwmoutWaveformActive;    /* Pin mask of playing channels */
+static bool pwmoutScheduleDirty;
+
+/*
+    Armed wehnelt setpoints (1/256 on cycles) and their voltages for
+    unblanked (index 0) and blanked (index 1) beam
+*/
+static uint32_t pwmoutBlankSetpoint[2];
+static uint16_t pwmoutBlankValue[2];
+static volatile bool pwmoutBlanked;
+
+/*
+    Slew tracking: the wehnelt clamp result of the last evaluation,
+    channels found slewing by the last slope update and channels that
+    settled since the last poll (bit n: channel n)
+*/
+static bool pwmoutWehneltClamped;
+static pwmoutMask pwmoutSlewBusyMask;
+static volatile pwmoutMask pwmoutSlewDoneMask;
+
+/*
+    On time of a channel in ticks of the active profile, anything above
+    pwmoutPeriodMask keeps the output on
+*/
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS_DRIVEN);
+    assigns \nothing;
+*/
+static uint16_t pwmoutScheduleTicks(
+    uint8_t channel
+) {
+    uint16_t onCycles = pwmoutOnCyclesReal[channel];
+    uint8_t bits = pwmoutProfiles[pwmoutProfileActive].bits;
+    uint16_t onTicks;
+
+    if(onCycles > 0x3FF) {
+        return 0xFFFF;
+    }
+    if(bits <= 10) {
+        /* Rounded to the coarser resolution */
+        return (onCycles + ((0x01 << (10 - bits)) >> 1)) >> (10 - bits);
+    }
+
+    onTicks = onCycles << (bits - 10);
+    if(onCycles == pwmoutOnCycles[channel]) {
+        onTicks = onTicks | (pwmoutOnFraction[channel] >> (8 - (bits - 10)));
+    }
+    return onTicks;
+}
+
+/*
+    Builds the schedule for the current pwmoutOnCyclesReal into the
+    inactive buffer. Called from the timer ISR or with interrupts disabled
+*/
+/*@
+    assigns pwmoutSchedules[0 .. 1];
+    assigns pwmoutSchedulePending;
+*/
+static void pwmoutScheduleBuild() {
+    struct pwmoutSchedule* lpSched = &(pwmoutSchedules[pwmoutScheduleActive ^ 0x01]);
+    uint8_t i;
+    uint8_t j;
+    uint16_t onCycles;
+
+    lpSched->setMask = 0;
+    lpSched->eventCount = 0;
+
+    for(i = 0; i < PWMOUT_CHANNELS_DRIVEN; i=i+1) {
+        if((pwmoutChannelPin[i] & PWMOUT_SOFTWARE_PINS & (~pwmoutSigmaDeltaMask)) == 0) {
+            continue;
+        }
+
+        onCycles = pwmoutScheduleTicks(i);
+        if(onCycles == 0) {
+            continue; /* Never set */
+        }
+        lpSched->setMask = lpSched->setMask | pwmoutChannelPin[i];
+        if(onCycles > pwmoutPeriodMask) {
+            continue; /* Never cleared */
+        }
+
+        /* Insert into sorted event list, merging identical ticks */
+        for(j = 0; j < lpSched->eventCount; j=j+1) {
+            if(lpSched->eventTick[j] >= onCycles) {
+                break;
+            }
+        }
+        if((j < lpSched->eventCount) && (lpSched->eventTick[j] == onCycles)) {
+            lpSched->eventClearMask[j] = lpSched->eventClearMask[j] | pwmoutChannelPin[i];
+        } else {
+            uint8_t k;
+            for(k = lpSched->eventCount; k > j; k=k-1) {
+                lpSched->eventTick[k] = lpSched->eventTick[k-1];
+                lpSched->eventClearMask[k] = lpSched->eventClearMask[k-1];
+            }
+            lpSched->eventTick[j] = onCycles;
+            lpSched->eventClearMask[j] = pwmoutChannelPin[i];
+            lpSched->eventCount = lpSched->eventCount + 1;
+        }
+    }
+
+    pwmoutSchedulePending = true;
+}
+
+/*
+    Activates a freshly built schedule within the running period instead
+    of waiting for the period boundary. Pins are brought into the state
+    the new schedule has at the current tick. Called from an ISR or with
+    interrupts disabled
+*/
+/*@
+    assigns pwmoutScheduleActive;
+    assigns pwmoutSchedulePending;
+    assigns pwmoutNextEvent;
+    assigns pwmoutPortShadow;
+    assigns PORTL;
+    assigns PORTH;
+*/
+static void pwmoutScheduleActivateNow() {
+    struct pwmoutSchedule* lpSched;
+
+    if(pwmoutSchedulePending != true) {
+        return;
+    }
+    pwmoutScheduleActive = pwmoutScheduleActive ^ 0x01;
+    pwmoutSchedulePending = false;
+    lpSched = &(pwmoutSchedules[pwmoutScheduleActive]);
+
+    pwmoutPortShadow = lpSched->setMask;
+    pwmoutNextEvent = 0;
+    while((pwmoutNextEvent < lpSched->eventCount) && (lpSched->eventTick[pwmoutNextEvent] <= pwmoutTick)) {
+        pwmoutPortShadow = pwmoutPortShadow & (~(lpSched->eventClearMask[pwmoutNextEvent]));
+        pwmoutNextEvent = pwmoutNextEvent + 1;
+    }
+
+    /* Sigma-delta pins keep their current bit till the next tick */
+    pwmoutPinsWrite(((pwmoutMask)(~PWMOUT_SOFTWARE_PINS)) | pwmoutSigmaDeltaMask, pwmoutPortShadow & (~pwmoutSigmaDeltaMask));
+}
+
+/*
+    Derives the 16 bit sigma-delta duty of every sigma-delta channel from
+    the slope limited on cycles. The fractional part is only applied once
+    the channel has settled on its setpoint (while slewing or clamped the
+    integer part is used). Called from the timer ISR or with interrupts
+    disabled
+*/
+/*@
+    assigns pwmoutSigmaDeltaDuty[0 .. PWMOUT_CHANNELS-1];
+*/
+static void pwmoutSigmaDeltaUpdate() {
+    uint8_t i;
+
+    for(i = 0; i < PWMOUT_CHANNELS_DRIVEN; i=i+1) {
+        if((pwmoutSigmaDeltaMask & pwmoutChannelPin[i]) == 0) {
+            continue;
+        }
+
+        if(pwmoutOnCyclesReal[i] > 0x3FF) {
+            pwmoutSigmaDeltaDuty[i] = 0xFFFF; /* Permanently on */
+        } else if(pwmoutOnCyclesReal[i] == pwmoutOnCycles[i]) {
+            pwmoutSigmaDeltaDuty[i] = (pwmoutOnCyclesReal[i] << 6) | (pwmoutOnFraction[i] >> 2);
+        } else {
+            pwmoutSigmaDeltaDuty[i] = pwmoutOnCyclesReal[i] << 6;
+        }
+    }
+}
+
+/*
+    Verify that W and K are not spaced too far ... if they are clamp the
+    wehnelt. Cathode and wehnelt setpoints are compared in wehnelt counts (Q16)
+*/
+/*@
+    requires (pwmoutChannelCathode < PWMOUT_CHANNELS) || (pwmoutChannelCathode == PWMOUT_CHANNEL_UNUSED);
+    requires (pwmoutChannelWehnelt < PWMOUT_CHANNELS) || (pwmoutChannelWehnelt == PWMOUT_CHANNEL_UNUSED);
+    assigns pwmoutOnCyclesReal[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutWehneltClamped;
+*/
+static void pwmoutClampWehnelt() {
+    uint32_t kInW;
+    uint32_t wQ16;
+
+    if((pwmoutChannelCathode == PWMOUT_CHANNEL_UNUSED) || (pwmoutChannelWehnelt == PWMOUT_CHANNEL_UNUSED)) {
+        pwmoutWehneltClamped = false;
+        return;
+    }
+    kInW = ((uint32_t)pwmoutOnCyclesReal[pwmoutChannelCathode]) * PWM_RATIO_K_W_Q16;
+    wQ16 = ((uint32_t)pwmoutOnCyclesReal[pwmoutChannelWehnelt]) << 16;
+
+    pwmoutWehneltClamped = true;
+    if(kInW > (wQ16 + PWM_MAX_DIFFERENCE_W_K_NV_Q16)) {
+        pwmoutOnCyclesReal[pwmoutChannelWehnelt] = (uint16_t)((kInW - PWM_MAX_DIFFERENCE_W_K_NV_Q16) >> 16);
+    } else if(wQ16 > (kInW + PWM_MAX_DIFFERENCE_W_K_PV_Q16)) {
+        pwmoutOnCyclesReal[pwmoutChannelWehnelt] = (uint16_t)((kInW + PWM_MAX_DIFFERENCE_W_K_PV_Q16) >> 16);
+    } else {
+        pwmoutWehneltClamped = false;
+    }
+}
+
+#ifdef PWMOUT_HWTIMER5
+    /*
+        Transfers the duty cycles of channels 2, 3 and 4 into timer 5. In
+        non inverting fast PWM mode the output is high for OCR+1 counts,
+        zero duty requires disconnecting the compare output
+    */
+    /*@
+        assigns OCR5A, OCR5B, OCR5C, TCCR5A;
+    */
+    static void pwmoutHardwareUpdate() {
+        uint8_t comBits = 0;
+
+        if(pwmoutOnCyclesReal[4] != 0) { OCR5A = ((pwmoutOnCyclesReal[4] > 0x3FF) ? 0x400 : pwmoutOnCyclesReal[4]) - 1; comBits = comBits | 0x80; }
+        if(pwmoutOnCyclesReal[3] != 0) { OCR5B = ((pwmoutOnCyclesReal[3] > 0x3FF) ? 0x400 : pwmoutOnCyclesReal[3]) - 1; comBits = comBits | 0x20; }
+        if(pwmoutOnCyclesReal[2] != 0) { OCR5C = ((pwmoutOnCyclesReal[2] > 0x3FF) ? 0x400 : pwmoutOnCyclesReal[2]) - 1; comBits = comBits | 0x08; }
+
+        TCCR5A = comBits | 0x03; /* WGM51:50 (fast PWM 10 bit together with WGM52 in TCCR5B) */
+    }
+#endif
+
+/*
+    Loads point index of the table into the player of channel
+*/
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS_DRIVEN);
+    assigns pwmoutOnCycles[channel];
+    assigns pwmoutOnCyclesReal[channel];
+    assigns pwmoutWaveformPlayers[channel].index;
+    assigns pwmoutWaveformPlayers[channel].dwellLeft;
+*/
+static inline void pwmoutWaveformLoadPoint(
+    uint8_t channel,
+    uint8_t index
+) {
+    pwmoutWaveformPlayers[channel].index = index;
+    pwmoutWaveformPlayers[channel].dwellLeft = pwmoutWaveformPoints[index].dwellTicks;
+    pwmoutOnCycles[channel] = pwmoutWaveformPoints[index].onCycles;
+    pwmoutOnCyclesReal[channel] = pwmoutWaveformPoints[index].onCycles;
+}
+
+/*
+    Hands a channel back to the slope limiter after playback
+*/
+static void pwmoutWaveformRelease(
+    uint8_t channel,
+    uint8_t state
+) {
+    pwmoutWaveformPlayers[channel].state = state;
+    pwmoutWaveformActive = pwmoutWaveformActive & (~pwmoutChannelPin[channel]);
+    pwmoutApplyOnCycles(channel);
+}
+
+/*
+    Called every tick while any player is running
+*/
+static inline void pwmoutWaveformTick() {
+    uint8_t i;
+    uint8_t next;
+    bool bChanged = false;
+    struct pwmoutWaveformPlayer* lpPlayer;
+
+    for(i = 0; i < PWMOUT_CHANNELS_DRIVEN; i=i+1) {
+        lpPlayer = &(pwmoutWaveformPlayers[i]);
+        if(lpPlayer->state != PWMOUT_WAVEFORM_RUNNING) {
+            continue;
+        }
+
+        lpPlayer->dwellLeft = lpPlayer->dwellLeft - 1;
+        if(lpPlayer->dwellLeft != 0) {
+            continue;
+        }
+
+        next = lpPlayer->index + 1;
+        if(next == (lpPlayer->first + lpPlayer->count)) {
+            next = lpPlayer->first;
+            if(lpPlayer->loops != 0) {
+                lpPlayer->loopsLeft = lpPlayer->loopsLeft - 1;
+                if(lpPlayer->loopsLeft == 0) {
+                    pwmoutWaveformRelease(i, PWMOUT_WAVEFORM_DONE);
+                    continue;
+                }
+            }
+        }
+
+        pwmoutWaveformLoadPoint(i, next);
+        bChanged = true;
+    }
+
+    if(bChanged == true) {
+        pwmoutClampWehnelt();
+        pwmoutSigmaDeltaUpdate();
+        #ifdef PWMOUT_HWTIMER5
+            pwmoutHardwareUpdate();
+        #endif
+        pwmoutScheduleDirty = true;
+    }
+}
+
 static uint16_t slopeUpdateInterval = 0;
 
 ISR(TIMER2_COMPA_vect) {
     uint8_t i;
+    bool bPortUpdate = false;
+    pwmoutMask sigmaDeltaBits = 0;
+    SYSCLOCK_ISR_ENTER();
+
+    psuLimitSample();
 
     /*
         Implement a slope limit (limiting maximum dV/dt) on voltage
     */
     if(slopeUpdateInterval == 2048) {
-        for(i = 0; i < sizeof(pwmoutCurrentCycles)/sizeof(uint16_t)-1; i=i+1) {
-            if((i & 0x01) == 0) {
-                if(pwmoutOnCyclesReal[i] > pwmoutOnCycles[i]) {
-                    pwmoutOnCyclesReal[i] =  ((pwmoutOnCyclesReal[i] - pwmoutOnCycles[i]) > VMAXSLOPE_V_PER_S) ? (pwmoutOnCyclesReal[i] - VMAXSLOPE_V_PER_S) : pwmoutOnCycles[i];
-                } else if(pwmoutOnCyclesReal[i] < pwmoutOnCycles[i]) {
-                    pwmoutOnCyclesReal[i] =  ((pwmoutOnCycles[i] - pwmoutOnCyclesReal[i]) > VMAXSLOPE_V_PER_S) ? (pwmoutOnCyclesReal[i] + VMAXSLOPE_V_PER_S) : pwmoutOnCycles[i];
-                }
+        for(i = 0; i < PWMOUT_CHANNELS_DRIVEN; i=i+1) {
+            uint16_t slope = cfgOptions.pwmout.slope[i];
+
+            if((pwmoutWaveformActive & pwmoutChannelPin[i]) != 0) {
+                /* Output is driven by the waveform player */
+            } else if(slope == 0) {
+                pwmoutOnCyclesReal[i] = pwmoutOnCycles[i];
+            } else if(pwmoutOnCyclesReal[i] > pwmoutOnCycles[i]) {
+                pwmoutOnCyclesReal[i] =  ((pwmoutOnCyclesReal[i] - pwmoutOnCycles[i]) > slope) ? (pwmoutOnCyclesReal[i] - slope) : pwmoutOnCycles[i];
+            } else if(pwmoutOnCyclesReal[i] < pwmoutOnCycles[i]) {
+                pwmoutOnCyclesReal[i] =  ((pwmoutOnCycles[i] - pwmoutOnCyclesReal[i]) > slope) ? (pwmoutOnCyclesReal[i] + slope) : pwmoutOnCycles[i];
+            }
 
-                /* Set enable and disable for output according to set output voltage */
-                if(pwmoutOnCyclesReal[i >> 1] != 0) {
-                    psuStates[i >> 1].bOutputEnable = true;
+            if(pwmoutChannelPSU[i] < PSU_COUNT) {
+                /* Enable of a PSU follows the slope limited output of its voltage channel */
+                if(pwmoutOnCyclesReal[i] != 0) {
+                    psuStates[pwmoutChannelPSU[i]].bOutputEnable = true;
                 } else {
-                    psuStates[i >> 1].bOutputEnable = false;
+                    psuStates[pwmoutChannelPSU[i]].bOutputEnable = false;
                 }
-            } else {
-                pwmoutOnCyclesReal[i] = pwmoutOnCycles[i];
             }
         }
 	    /* Verify that W and K are not spaced too far ...  if they are clamp */
@@ -96,54 +611,107 @@ ISR(TIMER2_COMPA_vect) {
 	        }
 	    }
 #endif
+        pwmoutClampWehnelt();
+
+        pwmoutScheduleBuild();
+        pwmoutSigmaDeltaUpdate();
+        #ifdef PWMOUT_HWTIMER5
+            pwmoutHardwareUpdate();
+        #endif
+
+        /* Channels that were slewing and have reached their setpoint */
         {
-            float diff;
-	    float vW, vK;
-	    vK = pwmoutOnCyclesReal[0] * PWM_VPERDIVK;
-	    vW = pwmoutOnCyclesReal[2] * PWM_VPERDIVW;
-	    if(vK > vW) {
-                diff = vK - vW;
-		if(diff > PWM_MAX_DIFFERENCE_W_K_NV) {
-		    pwmoutOnCyclesReal[2] = (unsigned int)(vK - PWM_MAX_DIFFERENCE_W_K_NV) / PWM_VPERDIVW;
-		}
-	    } else {
-		diff = vW - vK;
-		if(diff > PWM_MAX_DIFFERENCE_W_K_PV) {
-		    pwmoutOnCyclesReal[2] = (unsigned int)(vK + PWM_MAX_DIFFERENCE_W_K_PV) / PWM_VPERDIVW;
-		}
+            pwmoutMask busyMask = 0;
+            pwmoutMask playingMask = 0;
+            for(i = 0; i < PWMOUT_CHANNELS_DRIVEN; i=i+1) {
+                if((pwmoutWaveformActive & pwmoutChannelPin[i]) != 0) {
+                    playingMask = playingMask | (0x01 << i);
+                } else if(pwmoutOnCyclesReal[i] != pwmoutOnCycles[i]) {
+                    busyMask = busyMask | (0x01 << i);
+                }
             }
-	}
+            pwmoutSlewDoneMask = pwmoutSlewDoneMask | (pwmoutSlewBusyMask & (~busyMask) & (~playingMask));
+            pwmoutSlewBusyMask = busyMask;
+        }
+
+        pwmoutSlopeUpdateCount = pwmoutSlopeUpdateCount + 1;
     }
     slopeUpdateInterval = slopeUpdateInterval + 1;
-    
-    for(i = 0; i < sizeof(pwmoutCurrentCycles)/sizeof(uint16_t)-1; i=i+1) {
-        pwmoutCurrentCycles[i] = (pwmoutCurrentCycles[i] + 1) & 0x3FF;
-        if(pwmoutCurrentCycles[i] >= pwmoutOnCyclesReal[i]) {
-            if(i == 0) { PORTL = PORTL & ~(0x80); }
-            else if(i == 1) { PORTL = PORTL & ~(0x40); }
 
-            else if(i == 2) { PORTL = PORTL & ~(0x20); }
-            else if(i == 3) { PORTL = PORTL & ~(0x10); }
-
-            else if(i == 4) { PORTL = PORTL & ~(0x08); }
-            else if(i == 5) { PORTL = PORTL & ~(0x04); }
+    if(pwmoutWaveformActive != 0) {
+        pwmoutWaveformTick();
+    }
+    if((pwmoutCommitMask != 0) && (pwmoutTick == pwmoutPeriodMask)) {
+        /* Apply all committed setpoints together */
+        pwmoutMask commitMask = pwmoutCommitMask;
+        pwmoutCommitMask = 0;
 
-            else if(i == 6) { PORTL = PORTL & ~(0x02); }
-            else if(i == 7) { PORTL = PORTL & ~(0x01); }
-        } else {
-            if(i == 0) { PORTL = PORTL | (0x80); }
-            else if(i == 1) { PORTL = PORTL | (0x40); }
+        for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+            if((commitMask & (0x01 << i)) == 0) {
+                continue;
+            }
+            pwmoutApplyOnCycles(i);
+            if((pwmoutChannelDriven(i) == true) && (cfgOptions.pwmout.slope[i] == 0) && ((pwmoutWaveformActive & pwmoutChannelPin[i]) == 0)) {
+                pwmoutOnCyclesReal[i] = pwmoutOnCycles[i];
+            }
+        }
 
-            else if(i == 2) { PORTL = PORTL | (0x20); }
-            else if(i == 3) { PORTL = PORTL | (0x10); }
+        pwmoutClampWehnelt();
+        pwmoutSigmaDeltaUpdate();
+        #ifdef PWMOUT_HWTIMER5
+            pwmoutHardwareUpdate();
+        #endif
+        pwmoutScheduleDirty = true;
+    }
+    if((pwmoutScheduleDirty == true) && (pwmoutTick == pwmoutPeriodMask)) {
+        /* Ready for the period starting with the next tick */
+        pwmoutScheduleBuild();
+        pwmoutScheduleDirty = false;
+    }
 
-            else if(i == 4) { PORTL = PORTL | (0x08); }
-            else if(i == 5) { PORTL = PORTL | (0x04); }
+    /*
+        Software PWM: One compare against the next scheduled event and
+        at most one write to the PWM ports per tick
+    */
+    pwmoutTick = (pwmoutTick + 1) & pwmoutPeriodMask;
+    if(pwmoutTick == 0) {
+        if(pwmoutSchedulePending == true) {
+            pwmoutScheduleActive = pwmoutScheduleActive ^ 0x01;
+            pwmoutSchedulePending = false;
+        }
+        pwmoutNextEvent = 0;
+        pwmoutPortShadow = pwmoutSchedules[pwmoutScheduleActive].setMask;
+        bPortUpdate = true;
+    } else if(pwmoutNextEvent < pwmoutSchedules[pwmoutScheduleActive].eventCount) {
+        if(pwmoutSchedules[pwmoutScheduleActive].eventTick[pwmoutNextEvent] == pwmoutTick) {
+            pwmoutPortShadow = pwmoutPortShadow & (~(pwmoutSchedules[pwmoutScheduleActive].eventClearMask[pwmoutNextEvent]));
+            pwmoutNextEvent = pwmoutNextEvent + 1;
+            bPortUpdate = true;
+        }
+    }
 
-            else if(i == 6) { PORTL = PORTL | (0x02); }
-            else if(i == 7) { PORTL = PORTL | (0x01); }
+    /*
+        Sigma-delta channels: Carry of the duty accumulator is the output
+    */
+    if(pwmoutSigmaDeltaMask != 0) {
+        for(i = 0; i < PWMOUT_CHANNELS_DRIVEN; i=i+1) {
+            if((pwmoutSigmaDeltaMask & pwmoutChannelPin[i]) != 0) {
+                uint16_t accuOld = pwmoutSigmaDeltaAccu[i];
+                pwmoutSigmaDeltaAccu[i] = accuOld + pwmoutSigmaDeltaDuty[i];
+                if((pwmoutSigmaDeltaAccu[i] < accuOld) || (pwmoutSigmaDeltaDuty[i] == 0xFFFF)) {
+                    sigmaDeltaBits = sigmaDeltaBits | pwmoutChannelPin[i];
+                }
+            }
         }
+        bPortUpdate = true;
+    }
+
+    if(bPortUpdate == true) {
+        /* A channel just switched to sigma-delta may still be in the running schedule */
+        pwmoutPinsWrite((pwmoutMask)(~PWMOUT_SOFTWARE_PINS), (pwmoutPortShadow & (~pwmoutSigmaDeltaMask)) | sigmaDeltaBits);
     }
+
+    SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_TIMER2_COMPA);
 }
 
 void pwmoutInit() {
@@ -154,50 +722,1121 @@ void pwmoutInit() {
         cli();
     #endif
 
-    for(i = 0; i < sizeof(pwmoutCurrentCycles)/sizeof(uint16_t); i=i+1) {
-        pwmoutCurrentCycles[i] = 0;
+    for(i = 0; i < sizeof(pwmoutOnCycles)/sizeof(uint16_t); i=i+1) {
         pwmoutOnCycles[i] = 0;
+        pwmoutOnCyclesReal[i] = 0;
+        pwmoutOnCyclesSetpoint[i] = 0;
+    }
+    /* Validate the stored trim, out of range settings disable the trim of that PSU */
+    cfgOptions.voltageTrim.enable = cfgOptions.voltageTrim.enable & ((0x01 << PSU_COUNT) - 1);
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        pwmoutTrimIntegral[i] = 0;
+        if((cfgOptions.voltageTrim.gain[i] > PWMOUT_TRIM_GAIN_MAX) || (cfgOptions.voltageTrim.clamp[i] > PWMOUT_TRIM_CLAMP_MAX)) {
+            cfgOptions.voltageTrim.enable = cfgOptions.voltageTrim.enable & (~(0x01 << i));
+            cfgOptions.voltageTrim.gain[i] = PWMOUT_TRIM_GAIN_DEFAULT;
+            cfgOptions.voltageTrim.clamp[i] = PWMOUT_TRIM_CLAMP_DEFAULT;
+        }
+    }
+    for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+        pwmoutChannelPSU[i] = PWMOUT_CHANNEL_UNUSED;
+    }
+    pwmoutChannelCathode = PWMOUT_CHANNEL_UNUSED;
+    pwmoutChannelWehnelt = PWMOUT_CHANNEL_UNUSED;
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        pwmoutChannelPSU[psuDescriptors[i].pwmVoltage] = i;
+        pwmoutChannelPSU[psuDescriptors[i].pwmCurrent] = i | PWMOUT_CHANNEL_CURRENT;
+        if((psuDescriptors[i].roles & PSU_ROLE_CATHODE) != 0) {
+            pwmoutChannelCathode = psuDescriptors[i].pwmVoltage;
+        }
+        if((psuDescriptors[i].roles & PSU_ROLE_WEHNELT) != 0) {
+            pwmoutChannelWehnelt = psuDescriptors[i].pwmVoltage;
+        }
+    }
+    if(pwmoutChannelCathode == PWMOUT_CHANNEL_UNUSED) {
+        pwmoutChannelWehnelt = PWMOUT_CHANNEL_UNUSED; /* Nothing to clamp to, no blanking */
     }
+    pwmoutSlopeUpdateCount = 0;
+    pwmoutTrimLastUpdate = 0;
+
+    for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+        pwmoutWaveformPlayers[i].state = PWMOUT_WAVEFORM_IDLE;
+    }
+    for(i = 0; i < PWMOUT_WAVEFORM_POINTS; i=i+1) {
+        pwmoutWaveformPoints[i].onCycles = 0;
+        pwmoutWaveformPoints[i].dwellTicks = 0;
+        pwmoutWaveformPoints[i].channel = 0xFF;
+    }
+    pwmoutWaveformActive = 0;
+    pwmoutScheduleDirty = false;
+    pwmoutStagedMask = 0;
+    pwmoutCommitMask = 0;
+    pwmoutBlanked = false;
+    pwmoutWehneltClamped = false;
+    pwmoutSlewBusyMask = 0;
+    pwmoutSlewDoneMask = 0;
+
+    pwmoutTick = 0;
+    pwmoutNextEvent = 0;
+    pwmoutPortShadow = 0;
+    pwmoutScheduleActive = 0;
+
+    /* Validate stored output modes (unknown settings fall back to PWM) and slope limits */
+    pwmoutSigmaDeltaMask = 0;
+    for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+        pwmoutOnFraction[i] = 0;
+        pwmoutSigmaDeltaDuty[i] = 0;
+        pwmoutSigmaDeltaAccu[i] = 0;
+        if(pwmoutSetMode(i, cfgOptions.pwmout.mode[i]) != true) {
+            cfgOptions.pwmout.mode[i] = PWMOUT_MODE_PWM;
+        }
+        if(cfgOptions.pwmout.slope[i] > PWMOUT_SLOPE_MAX) {
+            cfgOptions.pwmout.slope[i] = (pwmoutChannelPSU[i] < PSU_COUNT) ? PWMOUT_SLOPE_DEFAULT : 0;
+        }
+        pwmoutCalibrationPrepare(i);
+    }
+    if(pwmoutSetProfile(cfgOptions.pwmout.profile) != true) {
+        pwmoutSetProfile(PWMOUT_PROFILE_DEFAULT);
+    }
+
+    pwmoutBlankArm(cfgOptions.beamOnRampTargets.wehneltCylinder, cfgOptions.beamOnRampTargets.wehneltCylinderBlank);
+    if(pwmoutBlankSetTrigger(cfgOptions.blanking.trigger) != true) {
+        pwmoutBlankSetTrigger(PWMOUT_BLANK_TRIGGER_OFF);
+    }
+
+    #ifdef PWMOUT_HWTIMER5
+        TCNT5   = 0;
+        OCR5A   = 0;
+        OCR5B   = 0;
+        OCR5C   = 0;
+        TCCR5A  = 0x03;     /* Fast PWM 10 bit, compare outputs disconnected till duty is set */
+        TCCR5B  = 0x08 | 0x01; /* WGM52, no prescaler (15.6 kHz) */
+    #endif
 
     bFilamentOn = false;
 
     TCNT2   = 0;
     TCCR2A  = 0x02;      /* CTC mode (up to OCR2A, disable OCR output pins) */
-    OCR2A   = PWM_TIMERTICK_OVERFLOWVAL; /* Count up to one - one int per tick */
+    OCR2A   = pwmoutProfiles[pwmoutProfileActive].overflowVal; /* One interrupt per tick */
     TIMSK2  = 0x02;      /* Set OCIE2A flag to enable interrupts on output compare */
     TCCR2B  = PWM_TIMERTICK_PRESCALER;
 
     SREG = sregOld;
 }
 
-void setPSUVolts(
-    uint16_t v,
-    uint8_t psu
-) {
-    uint16_t dutyCycleOn;
-    
-    switch(psu) {
-        case 1:         dutyCycleOn = (uint16_t)(((double)v) / PWM_VPERDIVK); pwmoutOnCycles[0] = dutyCycleOn; psuStates[0].setVTarget = v; break;
-        case 2:         dutyCycleOn = (uint16_t)(((double)v) / PWM_VPERDIVW); pwmoutOnCycles[2] = dutyCycleOn; psuStates[1].setVTarget = v;break;
-        case 3:         dutyCycleOn = (uint16_t)(((double)v) / PWM_VPERDIVFOC); pwmoutOnCycles[4] = dutyCycleOn; psuStates[2].setVTarget = v;break;
-        case 4:         dutyCycleOn = (uint16_t)(((double)v) / PWM_VPERDIV4); pwmoutOnCycles[6] = dutyCycleOn; psuStates[3].setVTarget = v;break;
-        default:        return;
+/*
+    Called from the overcurrent trip in the ADC ISR (or with interrupts
+    disabled): Drops all voltage and current setpoints to zero without any
+    slope limiting and pulls all software PWM outputs low immediately
+*/
+/*@
+    assigns pwmoutOnCycles[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutOnCyclesReal[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutOnCyclesSetpoint[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutSigmaDeltaDuty[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutWaveformPlayers[0 .. PWMOUT_CHANNELS-1].state;
+    assigns pwmoutWaveformActive;
+    assigns pwmoutStagedMask;
+    assigns pwmoutCommitMask;
+    assigns pwmoutSchedules[0 .. 1];
+    assigns pwmoutPortShadow;
+    assigns PORTL;
+    assigns PORTH;
+
+    ensures PORTL == 0x00;
+*/
+void pwmoutEmergencyOff() {
+    uint8_t i;
+
+    for(i = 0; i < sizeof(pwmoutOnCycles)/sizeof(uint16_t); i=i+1) {
+        pwmoutOnCycles[i] = 0;
+        pwmoutOnCyclesReal[i] = 0;
+        pwmoutOnCyclesSetpoint[i] = 0;
+        pwmoutSigmaDeltaDuty[i] = 0;
+        if(pwmoutWaveformPlayers[i].state == PWMOUT_WAVEFORM_RUNNING) {
+            pwmoutWaveformPlayers[i].state = PWMOUT_WAVEFORM_IDLE;
+        }
+    }
+    pwmoutWaveformActive = 0;
+    pwmoutStagedMask = 0;
+    pwmoutCommitMask = 0;
+
+    /* Both schedules empty so neither the running nor a pending one sets pins again */
+    for(i = 0; i < 2; i=i+1) {
+        pwmoutSchedules[i].setMask = 0;
+        pwmoutSchedules[i].eventCount = 0;
     }
+    pwmoutPortShadow = 0;
+    #ifdef PWMOUT_HWTIMER5
+        TCCR5A = 0x03; /* Disconnect compare outputs */
+    #endif
+    PORTL = 0x00;
+    #if PWMOUT_CHANNELS > 8
+        PORTH = PORTH & (~PWMOUT_PORTH_PINS);
+    #endif
 }
 
-void setPSUMicroamps(
-    uint16_t ua,
-    uint8_t psu
+/*
+    Transfers setpoint plus trim (voltage channels only) of a channel into
+    the on cycles read by the timer ISR. Setpoint is read with interrupts
+    disabled so an overcurrent trip in between can not be undone
+*/
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns pwmoutOnCycles[channel];
+    assigns pwmoutOnFraction[channel];
+*/
+static void pwmoutApplyOnCycles(
+    uint8_t channel
 ) {
-    uint16_t dutyCycleOn = (uint16_t)(((double)ua) / PWM_VPERUA);
+    int32_t onCycles;
+    uint8_t sregOld = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
 
-    switch(psu) {
-        case 1:         pwmoutOnCycles[1] = dutyCycleOn; psuStates[0].setILimit = ua; break;
-        case 2:         pwmoutOnCycles[3] = dutyCycleOn; psuStates[1].setILimit = ua; break;
-        case 3:         pwmoutOnCycles[5] = dutyCycleOn; psuStates[2].setILimit = ua; break;
-        case 4:         pwmoutOnCycles[7] = dutyCycleOn; psuStates[3].setILimit = ua; break;
-        default:        return;
+    onCycles = (int32_t)pwmoutOnCyclesSetpoint[channel];
+    if((pwmoutChannelPSU[channel] < PSU_COUNT) && (onCycles != 0)) {
+        onCycles = onCycles + pwmoutTrimIntegral[pwmoutChannelPSU[channel]];
+        if(onCycles < 0) {
+            onCycles = 0;
+        }
+    }
+    if(onCycles > 0xFFFFFFL) {
+        onCycles = 0xFFFFFFL;
+    }
+
+    /* A committed setpoint is transferred by the ISR at the period boundary */
+    if((pwmoutCommitMask & (0x01 << channel)) == 0) {
+        /* Fraction is only used by sigma-delta channels */
+        pwmoutOnFraction[channel] = (uint8_t)(onCycles & 0xFF);
+        if((pwmoutChannelDriven(channel) != true) || ((pwmoutWaveformActive & pwmoutChannelPin[channel]) == 0)) {
+            pwmoutOnCycles[channel] = (uint16_t)(onCycles >> 8);
+        }
+    }
+
+    SREG = sregOld;
+}
+
+/*
+    (value * scaleQ16) >> 8 without 64 bit arithmetic, scaleQ16 has to be
+    below 2^24
+*/
+/*@
+    requires scaleQ16 <= PWMOUT_SCALE_Q16_MAX;
+    assigns \nothing;
+*/
+static inline uint32_t pwmoutMultiplyQ16ToQ8(
+    uint16_t value,
+    uint32_t scaleQ16
+) {
+    return (((uint32_t)value) * (scaleQ16 >> 8)) + ((((uint32_t)value) * (scaleQ16 & 0xFF)) >> 8);
+}
+
+/*
+    Converts volts (or microamps) into on cycles in 1/256
+*/
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns \nothing;
+*/
+static uint32_t pwmoutValueToSetpoint(
+    uint8_t channel,
+    uint16_t value
+) {
+    uint8_t j;
+    uint8_t count = cfgOptions.pwmout.pwlCount[channel];
+    uint32_t onCycles;
+
+    if(count < 2) {
+        onCycles = pwmoutMultiplyQ16ToQ8(value, cfgOptions.pwmout.scale[channel]);
+    } else if(value <= cfgOptions.pwmout.pwlValue[channel][0]) {
+        onCycles = ((uint32_t)cfgOptions.pwmout.pwlOnCycles[channel][0]) << 2;
+    } else if(value >= cfgOptions.pwmout.pwlValue[channel][count-1]) {
+        onCycles = ((uint32_t)cfgOptions.pwmout.pwlOnCycles[channel][count-1]) << 2;
+    } else {
+        for(j = 0; j < (count - 2); j=j+1) {
+            if(value < cfgOptions.pwmout.pwlValue[channel][j+1]) {
+                break;
+            }
+        }
+        onCycles = (((uint32_t)cfgOptions.pwmout.pwlOnCycles[channel][j]) << 2)
+            + pwmoutMultiplyQ16ToQ8(value - cfgOptions.pwmout.pwlValue[channel][j], pwmoutPwlSlope[channel][j]);
+    }
+
+    return (onCycles > 0xFFFFFFL) ? 0xFFFFFFL : onCycles;
+}
+
+/*
+    Validates the table of a channel and derives its segment slopes.
+    Invalid tables are disabled
+*/
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns pwmoutPwlSlope[channel][0 .. PWMOUT_PWL_POINTS-2];
+    assigns cfgOptions.pwmout.pwlCount[channel];
+*/
+static bool pwmoutCalibrationPrepare(
+    uint8_t channel
+) {
+    uint8_t j;
+    uint8_t count = cfgOptions.pwmout.pwlCount[channel];
+    uint32_t slope;
+
+    if(cfgOptions.pwmout.scale[channel] > PWMOUT_SCALE_Q16_MAX) {
+        cfgOptions.pwmout.scale[channel] = PWMOUT_SCALE_Q16_MAX;
+    }
+
+    if(count > PWMOUT_PWL_POINTS) {
+        cfgOptions.pwmout.pwlCount[channel] = 0;
+        return false;
+    }
+
+    for(j = 0; (j + 1) < count; j=j+1) {
+        if((cfgOptions.pwmout.pwlValue[channel][j+1] <= cfgOptions.pwmout.pwlValue[channel][j]) || (cfgOptions.pwmout.pwlOnCycles[channel][j+1] < cfgOptions.pwmout.pwlOnCycles[channel][j])) {
+            cfgOptions.pwmout.pwlCount[channel] = 0;
+            return false;
+        }
+
+        /* 1/64 on cycles per unit to Q16 */
+        slope = (((uint32_t)(cfgOptions.pwmout.pwlOnCycles[channel][j+1] - cfgOptions.pwmout.pwlOnCycles[channel][j])) << 10) / (cfgOptions.pwmout.pwlValue[channel][j+1] - cfgOptions.pwmout.pwlValue[channel][j]);
+        pwmoutPwlSlope[channel][j] = (slope > PWMOUT_SCALE_Q16_MAX) ? PWMOUT_SCALE_Q16_MAX : slope;
+    }
+
+    return true;
+}
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns cfgOptions.pwmout.scale[channel];
+*/
+bool pwmoutCalibrationSetScale(
+    uint8_t channel,
+    uint32_t scaleQ16
+) {
+    if((channel >= PWMOUT_CHANNELS) || (scaleQ16 > PWMOUT_SCALE_Q16_MAX)) {
+        return false;
+    }
+    cfgOptions.pwmout.scale[channel] = scaleQ16;
+    if(channel == pwmoutChannelWehnelt) {
+        pwmoutBlankArm(pwmoutBlankValue[0], pwmoutBlankValue[1]);
+    }
+    return true;
+}
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns cfgOptions.pwmout.pwlValue[channel][index];
+    assigns cfgOptions.pwmout.pwlOnCycles[channel][index];
+*/
+bool pwmoutCalibrationSetPoint(
+    uint8_t channel,
+    uint8_t index,
+    uint16_t value,
+    uint16_t onCycles64
+) {
+    if((channel >= PWMOUT_CHANNELS) || (index >= PWMOUT_PWL_POINTS)) {
+        return false;
+    }
+    /* Points of the active table can only be changed after disabling it */
+    if(index < cfgOptions.pwmout.pwlCount[channel]) {
+        return false;
+    }
+
+    cfgOptions.pwmout.pwlValue[channel][index] = value;
+    cfgOptions.pwmout.pwlOnCycles[channel][index] = onCycles64;
+    return true;
+}
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns cfgOptions.pwmout.pwlCount[channel];
+    assigns pwmoutPwlSlope[channel][0 .. PWMOUT_PWL_POINTS-2];
+*/
+bool pwmoutCalibrationSetPointCount(
+    uint8_t channel,
+    uint8_t count
+) {
+    bool bResult;
+
+    if((channel >= PWMOUT_CHANNELS) || (count > PWMOUT_PWL_POINTS)) {
+        return false;
+    }
+    cfgOptions.pwmout.pwlCount[channel] = count;
+    bResult = pwmoutCalibrationPrepare(channel);
+    if(channel == pwmoutChannelWehnelt) {
+        pwmoutBlankArm(pwmoutBlankValue[0], pwmoutBlankValue[1]);
+    }
+    return bResult;
+}
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns pwmoutOnCyclesSetpoint[channel];
+    assigns pwmoutOnCycles[channel];
+    assigns pwmoutOnFraction[channel];
+*/
+static void pwmoutSetSetpoint(
+    uint8_t channel,
+    uint16_t value
+) {
+    pwmoutOnCyclesSetpoint[channel] = pwmoutValueToSetpoint(channel, value);
+    pwmoutApplyOnCycles(channel);
+}
+
+/*@
+    requires (psu >= 1) && (psu <= PSU_COUNT);
+    assigns cfgOptions.voltageTrim;
+    assigns pwmoutTrimIntegral[psu-1];
+*/
+bool pwmoutTrimConfigure(
+    uint8_t psu,
+    bool bEnable,
+    uint16_t gain,
+    uint16_t clamp
+) {
+    if((psu < 1) || (psu > PSU_COUNT) || (gain > PWMOUT_TRIM_GAIN_MAX) || (clamp > PWMOUT_TRIM_CLAMP_MAX)) {
+        return false;
+    }
+    psu = psu - 1;
+
+    cfgOptions.voltageTrim.gain[psu] = gain;
+    cfgOptions.voltageTrim.clamp[psu] = clamp;
+    if(bEnable == true) {
+        cfgOptions.voltageTrim.enable = cfgOptions.voltageTrim.enable | (0x01 << psu);
+    } else {
+        cfgOptions.voltageTrim.enable = cfgOptions.voltageTrim.enable & (~(0x01 << psu));
+        pwmoutTrimIntegral[psu] = 0;
+    }
+
+    /* Clamp may have shrunk */
+    if(pwmoutTrimIntegral[psu] > (((int32_t)clamp) << 8)) {
+        pwmoutTrimIntegral[psu] = ((int32_t)clamp) << 8;
+    } else if(pwmoutTrimIntegral[psu] < -(((int32_t)clamp) << 8)) {
+        pwmoutTrimIntegral[psu] = -(((int32_t)clamp) << 8);
+    }
+    pwmoutApplyOnCycles(psuDescriptors[psu].pwmVoltage);
+
+    return true;
+}
+
+int32_t pwmoutTrimGet(
+    uint8_t psu
+) {
+    if((psu < 1) || (psu > PSU_COUNT)) {
+        return 0;
+    }
+    return pwmoutTrimIntegral[psu - 1];
+}
+
+/*@
+    assigns pwmoutTrimIntegral[0 .. PSU_COUNT-1];
+    assigns pwmoutTrimLastUpdate;
+    assigns pwmoutOnCycles[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutOnFraction[0 .. PWMOUT_CHANNELS-1];
+*/
+void pwmoutTrimUpdate() {
+    uint8_t i;
+    uint8_t channel;
+    uint8_t sregOld;
+    uint8_t updates = pwmoutSlopeUpdateCount;
+    bool bSettled;
+    int32_t error;
+    int32_t limit;
+
+    /*
+        A correction written after update n is applied at update n+1 and
+        has settled at update n+2 - stepping earlier would integrate the
+        same error twice
+    */
+    if((uint8_t)(updates - pwmoutTrimLastUpdate) < 2) {
+        return;
+    }
+    pwmoutTrimLastUpdate = updates;
+
+    if(cfgOptions.voltageTrim.enable == 0) {
+        return;
+    }
+
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        if((cfgOptions.voltageTrim.enable & (0x01 << i)) == 0) {
+            continue;
+        }
+        if((psuStates[i].setVTarget == 0) || (psuStates[i].limitMode != psuLimit_Voltage)) {
+            continue;
+        }
+
+        /* Slewing, clamped or waveform driven outputs are not integrated */
+        sregOld = SREG;
+        #ifndef FRAMAC_SKIP
+            cli();
+        #endif
+        channel = psuDescriptors[i].pwmVoltage;
+        bSettled = ((pwmoutOnCyclesReal[channel] == pwmoutOnCycles[channel]) && ((pwmoutWaveformActive & pwmoutChannelPin[channel]) == 0)) ? true : false;
+        SREG = sregOld;
+        if(bSettled != true) {
+            continue;
+        }
+
+        error = ((int32_t)psuStates[i].setVTarget) - ((int32_t)adcCalibratedValue((i << 1), psuStates[i].realV));
+        limit = ((int32_t)cfgOptions.voltageTrim.clamp[i]) << 8;
+
+        pwmoutTrimIntegral[i] = pwmoutTrimIntegral[i] + error * ((int32_t)cfgOptions.voltageTrim.gain[i]);
+        if(pwmoutTrimIntegral[i] > limit) {
+            pwmoutTrimIntegral[i] = limit;
+        } else if(pwmoutTrimIntegral[i] < -limit) {
+            pwmoutTrimIntegral[i] = -limit;
+        }
+
+        pwmoutApplyOnCycles(channel);
+    }
+}
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns cfgOptions.pwmout.mode[channel];
+    assigns pwmoutSigmaDeltaMask;
+    assigns pwmoutSigmaDeltaAccu[channel];
+    assigns pwmoutSigmaDeltaDuty[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutSchedules[0 .. 1];
+    assigns pwmoutSchedulePending;
+*/
+bool pwmoutSetMode(
+    uint8_t channel,
+    uint8_t mode
+) {
+    uint8_t sregOld;
+
+    if(channel >= PWMOUT_CHANNELS) {
+        return false;
+    }
+    if(mode == PWMOUT_MODE_SIGMADELTA) {
+        /* Only pins generated in software can be modulated */
+        if((pwmoutChannelDriven(channel) != true) || ((pwmoutChannelPin[channel] & PWMOUT_SOFTWARE_PINS) == 0)) {
+            return false;
+        }
+    } else if(mode != PWMOUT_MODE_PWM) {
+        return false;
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    cfgOptions.pwmout.mode[channel] = mode;
+    if(mode == PWMOUT_MODE_SIGMADELTA) {
+        pwmoutSigmaDeltaMask = pwmoutSigmaDeltaMask | pwmoutChannelPin[channel];
+    } else {
+        pwmoutSigmaDeltaMask = pwmoutSigmaDeltaMask & (~pwmoutChannelPin[channel]);
+    }
+    pwmoutSigmaDeltaAccu[channel] = 0;
+    pwmoutSigmaDeltaUpdate();
+    pwmoutScheduleBuild();
+
+    SREG = sregOld;
+    return true;
+}
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns cfgOptions.pwmout.slope[channel];
+*/
+bool pwmoutSetSlope(
+    uint8_t channel,
+    uint16_t slope
+) {
+    uint8_t sregOld;
+
+    if((channel >= PWMOUT_CHANNELS) || (slope > PWMOUT_SLOPE_MAX)) {
+        return false;
+    }
+
+    /* 16 bit value is read by the timer ISR */
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    cfgOptions.pwmout.slope[channel] = slope;
+    SREG = sregOld;
+
+    return true;
+}
+
+/*@
+    requires (index >= 0) && (index < PWMOUT_WAVEFORM_POINTS);
+    assigns pwmoutWaveformPoints[index];
+*/
+bool pwmoutWaveformSetPoint(
+    uint8_t index,
+    uint8_t channel,
+    uint16_t value,
+    uint16_t dwellTicks
+) {
+    uint32_t onCycles;
+    uint8_t i;
+    uint8_t sregOld;
+
+    if((index >= PWMOUT_WAVEFORM_POINTS) || (channel >= PWMOUT_CHANNELS) || (pwmoutChannelDriven(channel) != true) || (dwellTicks == 0)) {
+        return false;
+    }
+
+    /* Points of a running waveform can not be replaced */
+    for(i = 0; i < PWMOUT_CHANNELS_DRIVEN; i=i+1) {
+        if((pwmoutWaveformPlayers[i].state == PWMOUT_WAVEFORM_RUNNING) && (index >= pwmoutWaveformPlayers[i].first) && (index < (pwmoutWaveformPlayers[i].first + pwmoutWaveformPlayers[i].count))) {
+            return false;
+        }
+    }
+
+    onCycles = pwmoutValueToSetpoint(channel, value) >> 8;
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    pwmoutWaveformPoints[index].onCycles = (onCycles > 0xFFFF) ? 0xFFFF : (uint16_t)onCycles;
+    pwmoutWaveformPoints[index].dwellTicks = dwellTicks;
+    pwmoutWaveformPoints[index].channel = channel;
+    SREG = sregOld;
+
+    return true;
+}
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns pwmoutWaveformPlayers[channel];
+    assigns pwmoutWaveformActive;
+    assigns pwmoutOnCycles[channel];
+    assigns pwmoutOnCyclesReal[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutSigmaDeltaDuty[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutScheduleDirty;
+*/
+bool pwmoutWaveformStart(
+    uint8_t channel,
+    uint8_t first,
+    uint8_t count,
+    uint16_t loops
+) {
+    uint8_t i;
+    uint8_t sregOld;
+    struct pwmoutWaveformPlayer* lpPlayer;
+
+    if((channel >= PWMOUT_CHANNELS) || (pwmoutChannelDriven(channel) != true) || (count == 0) || (((uint16_t)first + (uint16_t)count) > PWMOUT_WAVEFORM_POINTS)) {
+        return false;
+    }
+    for(i = first; i < (first + count); i=i+1) {
+        if(pwmoutWaveformPoints[i].channel != channel) {
+            return false;
+        }
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    lpPlayer = &(pwmoutWaveformPlayers[channel]);
+    lpPlayer->first = first;
+    lpPlayer->count = count;
+    lpPlayer->loops = loops;
+    lpPlayer->loopsLeft = loops;
+    lpPlayer->state = PWMOUT_WAVEFORM_RUNNING;
+    pwmoutWaveformActive = pwmoutWaveformActive | pwmoutChannelPin[channel];
+
+    pwmoutWaveformLoadPoint(channel, first);
+    pwmoutClampWehnelt();
+    pwmoutSigmaDeltaUpdate();
+    #ifdef PWMOUT_HWTIMER5
+        pwmoutHardwareUpdate();
+    #endif
+    pwmoutScheduleDirty = true;
+
+    SREG = sregOld;
+    return true;
+}
+
+/*@
+    assigns pwmoutWaveformPlayers[0 .. PWMOUT_CHANNELS-1].state;
+    assigns pwmoutWaveformActive;
+    assigns pwmoutOnCycles[channel];
+    assigns pwmoutOnFraction[channel];
+*/
+void pwmoutWaveformStop(
+    uint8_t channel
+) {
+    uint8_t sregOld;
+
+    if((channel >= PWMOUT_CHANNELS) || (pwmoutChannelDriven(channel) != true)) {
+        return;
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    if(pwmoutWaveformPlayers[channel].state == PWMOUT_WAVEFORM_RUNNING) {
+        pwmoutWaveformRelease(channel, PWMOUT_WAVEFORM_IDLE);
+    } else {
+        pwmoutWaveformPlayers[channel].state = PWMOUT_WAVEFORM_IDLE;
+    }
+    SREG = sregOld;
+}
+
+/*@
+    requires \valid(lpOut);
+    assigns *lpOut;
+*/
+bool pwmoutWaveformGetStatus(
+    uint8_t channel,
+    struct pwmoutWaveformStatus* lpOut
+) {
+    uint8_t sregOld;
+
+    if((channel >= PWMOUT_CHANNELS) || (pwmoutChannelDriven(channel) != true)) {
+        return false;
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    lpOut->state = pwmoutWaveformPlayers[channel].state;
+    lpOut->index = pwmoutWaveformPlayers[channel].index;
+    lpOut->loopsLeft = pwmoutWaveformPlayers[channel].loopsLeft;
+    SREG = sregOld;
+
+    return true;
+}
+
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS);
+    assigns pwmoutStagedSetpoint[channel];
+    assigns pwmoutStagedValue[channel];
+    assigns pwmoutStagedMask;
+*/
+static void pwmoutStage(
+    uint8_t channel,
+    uint16_t value
+) {
+    pwmoutStagedSetpoint[channel] = pwmoutValueToSetpoint(channel, value);
+    pwmoutStagedValue[channel] = value;
+    pwmoutStagedMask = pwmoutStagedMask | (0x01 << channel);
+}
+
+bool pwmoutStageVolts(
+    uint16_t v,
+    uint8_t psu
+) {
+    if((psu < 1) || (psu > PSU_COUNT)) {
+        return false;
+    }
+    pwmoutStage(psuDescriptors[psu - 1].pwmVoltage, v);
+    return true;
+}
+
+bool pwmoutStageMicroamps(
+    uint16_t ua,
+    uint8_t psu
+) {
+    if((psu < 1) || (psu > PSU_COUNT)) {
+        return false;
+    }
+    pwmoutStage(psuDescriptors[psu - 1].pwmCurrent, ua);
+    return true;
+}
+
+/*@
+    assigns pwmoutOnCyclesSetpoint[0 .. PWMOUT_CHANNELS-1];
+    assigns psuStates[0 .. PSU_COUNT-1].setVTarget;
+    assigns psuStates[0 .. PSU_COUNT-1].setILimit;
+    assigns pwmoutStagedMask;
+    assigns pwmoutCommitMask;
+*/
+void pwmoutCommit() {
+    uint8_t i;
+    uint8_t sregOld;
+
+    if(pwmoutStagedMask == 0) {
+        return;
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+        if((pwmoutStagedMask & (0x01 << i)) == 0) {
+            continue;
+        }
+        pwmoutOnCyclesSetpoint[i] = pwmoutStagedSetpoint[i];
+        if(pwmoutChannelPSU[i] < PSU_COUNT) {
+            psuStates[pwmoutChannelPSU[i]].setVTarget = pwmoutStagedValue[i];
+        } else if(pwmoutChannelPSU[i] != PWMOUT_CHANNEL_UNUSED) {
+            psuStates[pwmoutChannelPSU[i] & (~PWMOUT_CHANNEL_CURRENT)].setILimit = pwmoutStagedValue[i];
+        }
+    }
+    pwmoutCommitMask = pwmoutCommitMask | pwmoutStagedMask;
+    pwmoutStagedMask = 0;
+
+    SREG = sregOld;
+}
+
+/*@
+    assigns pwmoutStagedMask;
+*/
+void pwmoutStageDiscard() {
+    pwmoutStagedMask = 0;
+}
+
+pwmoutMask pwmoutStageGetMask() {
+    return pwmoutStagedMask;
+}
+
+/*@
+    assigns pwmoutBlankSetpoint[0 .. 1];
+    assigns pwmoutBlankValue[0 .. 1];
+*/
+void pwmoutBlankArm(
+    uint16_t vUnblank,
+    uint16_t vBlank
+) {
+    uint8_t sregOld = SREG;
+    uint32_t setpointUnblank = 0;
+    uint32_t setpointBlank = 0;
+
+    if(pwmoutChannelWehnelt != PWMOUT_CHANNEL_UNUSED) {
+        setpointUnblank = pwmoutValueToSetpoint(pwmoutChannelWehnelt, vUnblank);
+        setpointBlank = pwmoutValueToSetpoint(pwmoutChannelWehnelt, vBlank);
+    }
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    pwmoutBlankSetpoint[0] = setpointUnblank;
+    pwmoutBlankSetpoint[1] = setpointBlank;
+    pwmoutBlankValue[0] = vUnblank;
+    pwmoutBlankValue[1] = vBlank;
+    SREG = sregOld;
+}
+
+/*
+    Fast path of pwmoutBlank. Called from the pin change ISR or with
+    interrupts disabled
+*/
+/*@
+    assigns pwmoutOnCyclesSetpoint[pwmoutChannelWehnelt];
+    assigns pwmoutOnCycles[pwmoutChannelWehnelt];
+    assigns pwmoutOnCyclesReal[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutOnFraction[pwmoutChannelWehnelt];
+    assigns pwmoutCommitMask;
+    assigns pwmoutWaveformPlayers[pwmoutChannelWehnelt].state;
+    assigns pwmoutWaveformActive;
+    assigns pwmoutSigmaDeltaDuty[0 .. PWMOUT_CHANNELS-1];
+    assigns pwmoutSchedules[0 .. 1];
+    assigns psuStates[0 .. PSU_COUNT-1].setVTarget;
+    assigns pwmoutBlanked;
+    assigns PORTL;
+    assigns PORTH;
+*/
+static bool pwmoutBlankApply(
+    bool bBlank
+) {
+    uint8_t idx = (bBlank == true) ? 1 : 0;
+    uint8_t channel = pwmoutChannelWehnelt;
+
+    if((channel == PWMOUT_CHANNEL_UNUSED) || (pwmoutOnCyclesSetpoint[pwmoutChannelCathode] == 0)) {
+        return false;
+    }
+
+    if(pwmoutWaveformPlayers[channel].state == PWMOUT_WAVEFORM_RUNNING) {
+        pwmoutWaveformPlayers[channel].state = PWMOUT_WAVEFORM_IDLE;
+        pwmoutWaveformActive = pwmoutWaveformActive & (~pwmoutChannelPin[channel]);
+    }
+    pwmoutCommitMask = pwmoutCommitMask & (~(0x01 << channel));
+
+    pwmoutOnCyclesSetpoint[channel] = pwmoutBlankSetpoint[idx];
+    pwmoutApplyOnCycles(channel);
+    pwmoutOnCyclesReal[channel] = pwmoutOnCycles[channel];  /* No slope limit */
+    pwmoutClampWehnelt();
+
+    pwmoutSigmaDeltaUpdate();
+    #ifdef PWMOUT_HWTIMER5
+        pwmoutHardwareUpdate();
+    #endif
+    pwmoutScheduleBuild();
+    pwmoutScheduleActivateNow();
+
+    psuStates[pwmoutChannelPSU[channel]].setVTarget = pwmoutBlankValue[idx];
+    pwmoutBlanked = bBlank;
+    return true;
+}
+
+bool pwmoutBlank(
+    bool bBlank
+) {
+    bool bResult;
+    uint8_t sregOld = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    bResult = pwmoutBlankApply(bBlank);
+    SREG = sregOld;
+
+    return bResult;
+}
+
+bool pwmoutBlankIsBlanked() {
+    return pwmoutBlanked;
+}
+
+/*
+    Applies the level of the trigger input. Called from the pin change
+    ISR or with interrupts disabled
+*/
+static void pwmoutBlankTriggerUpdate() {
+    bool bBlank;
+
+    if(cfgOptions.blanking.trigger == PWMOUT_BLANK_TRIGGER_HIGH) {
+        bBlank = ((PINK & 0x02) != 0) ? true : false;
+    } else if(cfgOptions.blanking.trigger == PWMOUT_BLANK_TRIGGER_LOW) {
+        bBlank = ((PINK & 0x02) == 0) ? true : false;
+    } else {
+        return;
+    }
+
+    if(bBlank != pwmoutBlanked) {
+        pwmoutBlankApply(bBlank);
+    }
+}
+
+ISR(PCINT2_vect) {
+    SYSCLOCK_ISR_ENTER();
+    pwmoutBlankTriggerUpdate();
+    SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_PCINT2);
+}
+
+/*@
+    assigns cfgOptions.blanking.trigger;
+    assigns DDRK, PORTK, DIDR2, PCMSK2, PCICR;
+*/
+bool pwmoutBlankSetTrigger(
+    uint8_t mode
+) {
+    uint8_t sregOld;
+
+    if(mode > PWMOUT_BLANK_TRIGGER_LOW) {
+        return false;
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    cfgOptions.blanking.trigger = mode;
+    if(mode == PWMOUT_BLANK_TRIGGER_OFF) {
+        PCMSK2 = PCMSK2 & (~0x02);
+        if(PCMSK2 == 0) {
+            PCICR = PCICR & (~0x04);
+        }
+    } else {
+        /* Flag is cleared first so a level change caused by the pull up is seen by the ISR */
+        PCMSK2 = PCMSK2 | 0x02;         /* PCINT17 */
+        PCIFR = 0x04;
+        DDRK = DDRK & (~0x02);
+        DIDR2 = DIDR2 & (~0x02);        /* Digital input buffer of ADC9 */
+        if(mode == PWMOUT_BLANK_TRIGGER_LOW) {
+            PORTK = PORTK | 0x02;
+        } else {
+            PORTK = PORTK & (~0x02);
+        }
+        PCICR = PCICR | 0x04;           /* PCIE2 */
+
+        pwmoutBlankTriggerUpdate();
+    }
+
+    SREG = sregOld;
+    return true;
+}
+
+/*@
+    assigns cfgOptions.pwmout.profile;
+    assigns pwmoutProfileActive;
+    assigns pwmoutPeriodMask;
+    assigns pwmoutTick;
+    assigns pwmoutSchedules[0 .. 1];
+    assigns pwmoutSchedulePending;
+    assigns OCR2A, TCNT2;
+*/
+bool pwmoutSetProfile(
+    uint8_t profile
+) {
+    uint8_t sregOld;
+
+    if(profile >= PWMOUT_PROFILE_COUNT) {
+        return false;
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    cfgOptions.pwmout.profile = profile;
+    pwmoutProfileActive = profile;
+    pwmoutPeriodMask = (0x01 << pwmoutProfiles[profile].bits) - 1;
+    pwmoutScheduleBuild();
+
+    /* Next tick starts a new period with the new schedule */
+    pwmoutTick = pwmoutPeriodMask;
+    OCR2A = pwmoutProfiles[profile].overflowVal;
+    TCNT2 = 0;
+
+    SREG = sregOld;
+    return true;
+}
+
+uint8_t pwmoutGetProfile() {
+    return pwmoutProfileActive;
+}
+
+/*@
+    requires \valid(lpOut);
+    assigns *lpOut;
+*/
+bool pwmoutGetProfileInfo(
+    uint8_t profile,
+    struct pwmoutProfileInfo* lpOut
+) {
+    if(profile >= PWMOUT_PROFILE_COUNT) {
+        return false;
+    }
+    lpOut->bits = pwmoutProfiles[profile].bits;
+    lpOut->tickMicros = pwmoutProfiles[profile].tickMicros;
+    return true;
+}
+
+/*
+    Remaining slope updates times the update interval, the first update
+    is due when slopeUpdateInterval passes 2048 again
+*/
+/*@
+    requires (channel >= 0) && (channel < PWMOUT_CHANNELS_DRIVEN);
+    assigns \nothing;
+*/
+static uint32_t pwmoutSlewEta(
+    uint8_t channel,
+    uint16_t ticksToUpdate
+) {
+    uint16_t slope = cfgOptions.pwmout.slope[channel];
+    uint16_t diff;
+    uint32_t steps;
+    uint32_t tickMicros;
+
+    if(pwmoutOnCyclesReal[channel] == pwmoutOnCycles[channel]) {
+        return 0;
+    }
+    diff = (pwmoutOnCyclesReal[channel] > pwmoutOnCycles[channel]) ? (pwmoutOnCyclesReal[channel] - pwmoutOnCycles[channel]) : (pwmoutOnCycles[channel] - pwmoutOnCyclesReal[channel]);
+    steps = (slope == 0) ? 1 : ((diff + slope - 1) / slope);
+
+    tickMicros = pwmoutProfiles[pwmoutProfileActive].tickMicros;
+
+    return (steps - 1) * ((PWMOUT_SLOPE_UPDATE_TICKS * tickMicros + 500) / 1000) + ((((uint32_t)ticksToUpdate) * tickMicros) / 1000);
+}
+
+/*@
+    requires \valid(lpOut);
+    assigns *lpOut;
+*/
+bool pwmoutSlewGetStatus(
+    uint8_t channel,
+    struct pwmoutSlewStatus* lpOut
+) {
+    uint8_t sregOld;
+    uint16_t ticksToUpdate;
+    uint32_t etaCathode;
+
+    if(channel >= PWMOUT_CHANNELS) {
+        return false;
+    }
+
+    lpOut->state = PWMOUT_SLEW_IDLE;
+    lpOut->onCycles = 0;
+    lpOut->target = 0;
+    lpOut->etaMillis = 0;
+    if(pwmoutChannelDriven(channel) != true) {
+        return true;
+    }
+
+    sregOld = SREG;
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+
+    ticksToUpdate = 2048 - slopeUpdateInterval;
+    lpOut->onCycles = pwmoutOnCyclesReal[channel];
+    lpOut->target = pwmoutOnCycles[channel];
+
+    if((pwmoutWaveformActive & pwmoutChannelPin[channel]) != 0) {
+        lpOut->state = PWMOUT_SLEW_WAVEFORM;
+    } else if(lpOut->onCycles != lpOut->target) {
+        lpOut->etaMillis = pwmoutSlewEta(channel, ticksToUpdate);
+        if((channel == pwmoutChannelWehnelt) && (pwmoutWehneltClamped == true)) {
+            lpOut->state = PWMOUT_SLEW_CLAMPED;
+            etaCathode = pwmoutSlewEta(pwmoutChannelCathode, ticksToUpdate);
+            if(etaCathode > lpOut->etaMillis) {
+                lpOut->etaMillis = etaCathode;
+            }
+        } else if(lpOut->onCycles < lpOut->target) {
+            lpOut->state = PWMOUT_SLEW_UP;
+        } else {
+            lpOut->state = PWMOUT_SLEW_DOWN;
+        }
+    }
+
+    SREG = sregOld;
+    return true;
+}
+
+/*@
+    assigns pwmoutSlewDoneMask;
+*/
+pwmoutMask pwmoutSlewPollDone() {
+    pwmoutMask doneMask;
+    uint8_t sregOld = SREG;
+
+    #ifndef FRAMAC_SKIP
+        cli();
+    #endif
+    doneMask = pwmoutSlewDoneMask;
+    pwmoutSlewDoneMask = 0;
+    SREG = sregOld;
+
+    return doneMask;
+}
+
+void setPSUVolts(
+    uint16_t v,
+    uint8_t psu
+) {
+    if((psu < 1) || (psu > PSU_COUNT)) {
+        return;
+    }
+    pwmoutSetSetpoint(psuDescriptors[psu - 1].pwmVoltage, v);
+    psuStates[psu - 1].setVTarget = v;
+}
+
+void setPSUMicroamps(
+    uint16_t ua,
+    uint8_t psu
+) {
+    if((psu < 1) || (psu > PSU_COUNT)) {
+        return;
     }
+    pwmoutSetSetpoint(psuDescriptors[psu - 1].pwmCurrent, ua);
+    psuStates[psu - 1].setILimit = ua;
 }
 
 #ifdef __cplusplus
@@ -9,13 +9,348 @@
     #endif
 #endif
 
+/* Channel count depends on PSU_COUNT */
+#include "./psu.h"
+
 #ifdef __cplusplus
     extern "C" {
 #endif
 
-extern uint16_t pwmoutOnCycles[8];
+/*
+    Nominal transfer of the outputs in volts (or microamps) per on cycle
+*/
+#define PWM_VPERDIVK (3.24781922941*0.899405351856)
+#define PWM_VPERDIVW (3.49231230262*0.899009900992)
+#define PWM_VPERDIVFOC 3.137850885
+#define PWM_VPERDIV4 3.1914893617
+#define PWM_VPERUA 0.979959039479
+
+/*
+    Setpoint conversion
+
+        Volts (or microamps) are converted into on cycles without floating
+        point: Either by a per channel Q16 scale (on cycles per unit * 65536)
+        or, if a channel has at least two points configured, by a piecewise
+        linear table of up to PWMOUT_PWL_POINTS (value, on cycles / 64)
+        points. Values outside the table are clamped to its first or last
+        point. Scale and table are kept in cfgOptions.pwmout
+*/
+#define PWMOUT_SCALE_Q16(unitsPerOnCycle)   ((uint32_t)((65536.0 / (unitsPerOnCycle)) + 0.5))
+#define PWMOUT_SCALE_Q16_MAX                0x00FFFFFFUL
+#define PWMOUT_PWL_POINTS                   6
+
+/*
+    PWM channels
+
+        Two per PSU (see psuDescriptors). Channels 0 ... 7 are generated on
+        PORTL, channels 8 ... 11 of the PSU_COUNT 5 and 6 builds on PH3 ...
+        PH6 (PWMOUT_PORTH_PINS). Masks of channels (bit n: channel n) and
+        of output pins only need 16 bits in these builds (pwmoutMask).
+*/
+#define PWMOUT_CHANNELS                     PSU_CHANNELS
+
+#if PWMOUT_CHANNELS > 8
+    #define PWMOUT_PORTH_PINS               ((PWMOUT_CHANNELS > 10) ? 0x78 : 0x18)
+    typedef uint16_t pwmoutMask;
+#else
+    typedef uint8_t pwmoutMask;
+#endif
+
+extern uint16_t pwmoutOnCycles[PWMOUT_CHANNELS];
+
+/*
+    Output modes of the software PWM channels
+
+        PWMOUT_MODE_PWM         1024 tick PWM period, 10 bit resolution
+        PWMOUT_MODE_SIGMADELTA  First order sigma-delta modulation with
+                                16 bit resolution. Quantisation noise is
+                                moved up to the tick rate which the RC
+                                filter removes much better than the 20 Hz
+                                PWM fundamental
+*/
+#define PWMOUT_MODE_PWM                     0
+#define PWMOUT_MODE_SIGMADELTA              1
 
 void pwmoutInit();
+void pwmoutEmergencyOff();
+
+/*
+    PWM profiles
+
+        Select resolution and tick rate of the software PWM. Setpoints
+        keep their 10 bit on cycle units, 8 bit profiles round them and
+        12 bit profiles add the fractional part of the setpoint once a
+        channel has settled (like sigma-delta channels do).
+
+        Profile Resolution  Tick    PWM frequency   ISR rate    Step (cathode)
+        0       10 bit      48 us   20.3 Hz         20.8 kHz    2.9 V
+        1        8 bit      48 us   81.4 Hz         20.8 kHz    11.7 V
+        2       12 bit      48 us    5.1 Hz         20.8 kHz    0.73 V
+        3       10 bit      32 us   30.5 Hz         31.3 kHz    2.9 V
+
+        Ripple after the RC output filters is about inversely proportional
+        to the PWM frequency: relative to profile 0 it is 1/4 with profile 1,
+        4 times with profile 2 and 2/3 with profile 3. The work per tick is
+        the same for all profiles, so ISR load only scales with the ISR
+        rate (profile 3 costs 1.5 times the CPU time of the others and may
+        lose ticks while the slope update runs). Everything counted in
+        ticks - waveform dwell times and the slope update interval - runs
+        faster by the same factor. Timer 5 hardware channels always use
+        10 bit at 15.6 kHz.
+*/
+#define PWMOUT_PROFILE_COUNT                4
+#define PWMOUT_PROFILE_DEFAULT              0
+
+struct pwmoutProfileInfo {
+    uint8_t                     bits;
+    uint8_t                     tickMicros;
+};
+
+/*
+    Activates a profile and stores it in cfgOptions. The running period
+    is cut short, the new one starts with the next tick
+*/
+bool pwmoutSetProfile(
+    uint8_t profile
+);
+uint8_t pwmoutGetProfile();
+bool pwmoutGetProfileInfo(
+    uint8_t profile,
+    struct pwmoutProfileInfo* lpOut
+);
+
+/*
+    Selects the output mode of a channel and stores it in cfgOptions.
+    Returns false for unknown modes and channels that can not be driven
+    in the requested mode
+*/
+bool pwmoutSetMode(
+    uint8_t channel,
+    uint8_t mode
+);
+
+/*
+    Sets the slope limit of a channel in on cycles per slope update
+    (0 disables limiting, at most PWMOUT_SLOPE_MAX) and stores it in
+    cfgOptions. Invalid stored limits are replaced on init by the default
+    (PWMOUT_SLOPE_DEFAULT on voltage channels, unlimited on the others)
+*/
+#define PWMOUT_SLOPE_MAX                    1023
+#define PWMOUT_SLOPE_DEFAULT                12
+
+bool pwmoutSetSlope(
+    uint8_t channel,
+    uint16_t slope
+);
+
+/*
+    Closed loop voltage trim
+
+        Slow integral loop run from the main loop. It compares the
+        calibrated readout of every enabled PSU against setVTarget and
+        trims the on cycles of its voltage channel. A step is only taken
+        when the previous correction has been applied by the slope limiter
+        and had one full slope update interval to settle, the PSU is in
+        voltage regulation and its output has reached the setpoint.
+*/
+void pwmoutTrimUpdate();
+
+/*
+    Configures the trim of PSU psu (1 ... 4) and stores it in cfgOptions.
+    gain is in 1/256 on cycles per volt of error and step (at most
+    PWMOUT_TRIM_GAIN_MAX), clamp limits the trim in on cycles (at most
+    PWMOUT_TRIM_CLAMP_MAX). Disabling discards the accumulated trim
+*/
+#define PWMOUT_TRIM_GAIN_MAX                1024
+#define PWMOUT_TRIM_GAIN_DEFAULT            32
+#define PWMOUT_TRIM_CLAMP_MAX               255
+#define PWMOUT_TRIM_CLAMP_DEFAULT           32
+
+bool pwmoutTrimConfigure(
+    uint8_t psu,
+    bool bEnable,
+    uint16_t gain,
+    uint16_t clamp
+);
+
+/*
+    Returns the current trim of PSU psu (1 ... 4) in 1/256 on cycles
+*/
+int32_t pwmoutTrimGet(
+    uint8_t psu
+);
+
+/*
+    Waveform player
+
+        A shared table of PWMOUT_WAVEFORM_POINTS points (setpoint and dwell
+        time in timer ticks of 48 us, see profiles) is played back by the
+        timer ISR. Each channel plays a contiguous range of the table,
+        optionally looped. While a channel is playing its points bypass the
+        slope limiter (the wehnelt / cathode clamp still applies). Stopping
+        or finishing hands the channel back to the slope limiter which
+        returns to the regular setpoint. An emergency off stops all players.
+
+        PWM channels only change at the period boundary, sigma-delta
+        channels follow every point immediately.
+*/
+#define PWMOUT_WAVEFORM_POINTS              64
+
+#define PWMOUT_WAVEFORM_IDLE                0
+#define PWMOUT_WAVEFORM_RUNNING             1
+#define PWMOUT_WAVEFORM_DONE                2
+
+struct pwmoutWaveformStatus {
+    uint8_t                     state;
+    uint8_t                     index;          /* Point currently output */
+    uint16_t                    loopsLeft;      /* 0 for endless playback */
+};
+
+/*
+    Stores point index of the table for channel. value is in volts for
+    voltage channels (even) and microamps for current channels (odd),
+    dwellTicks has to be at least 1
+*/
+bool pwmoutWaveformSetPoint(
+    uint8_t index,
+    uint8_t channel,
+    uint16_t value,
+    uint16_t dwellTicks
+);
+/*
+    Plays points first ... first+count-1 on channel. All points have to
+    be stored for this channel. loops = 0 repeats until stopped
+*/
+bool pwmoutWaveformStart(
+    uint8_t channel,
+    uint8_t first,
+    uint8_t count,
+    uint16_t loops
+);
+void pwmoutWaveformStop(
+    uint8_t channel
+);
+bool pwmoutWaveformGetStatus(
+    uint8_t channel,
+    struct pwmoutWaveformStatus* lpOut
+);
+
+/*
+    Staged setpoints
+
+        pwmoutStageVolts and pwmoutStageMicroamps collect setpoints without
+        touching the outputs. pwmoutCommit hands all staged setpoints to
+        the timer ISR which applies them together in the tick before the
+        next PWM period starts, so the slope limiter, the wehnelt / cathode
+        clamp and the PWM schedule never see a mix of old and new values.
+        Channels without slope limit take the new value in that same period.
+*/
+bool pwmoutStageVolts(
+    uint16_t v,
+    uint8_t psu
+);
+bool pwmoutStageMicroamps(
+    uint16_t ua,
+    uint8_t psu
+);
+void pwmoutCommit();
+void pwmoutStageDiscard();
+pwmoutMask pwmoutStageGetMask();
+
+/*
+    Beam blanking
+
+        The wehnelt setpoints for blanked and unblanked beam are converted
+        in advance (pwmoutBlankArm). Switching bypasses the slope limiter
+        and any pending commit, stops a waveform on the wehnelt channel and
+        takes effect within the running PWM period - the wehnelt / cathode
+        clamp still applies. Blanking is only possible while the cathode
+        setpoint is not zero so neither a trip nor a switched off supply
+        can be re-energised by the trigger input.
+
+        The external trigger is pin PK1 (PCINT17), its polarity is kept in
+        cfgOptions.blanking.trigger. The low active mode enables the pull up.
+*/
+#define PWMOUT_BLANK_TRIGGER_OFF            0
+#define PWMOUT_BLANK_TRIGGER_HIGH           1
+#define PWMOUT_BLANK_TRIGGER_LOW            2
+
+/*
+    Converts the wehnelt voltages for unblanked and blanked beam
+*/
+void pwmoutBlankArm(
+    uint16_t vUnblank,
+    uint16_t vBlank
+);
+/*
+    Switches to the armed blank or unblank setpoint. Returns false (and
+    changes nothing) while the cathode setpoint is zero
+*/
+bool pwmoutBlank(
+    bool bBlank
+);
+bool pwmoutBlankIsBlanked();
+bool pwmoutBlankSetTrigger(
+    uint8_t mode
+);
+
+/*
+    Slew state
+
+        Tells whether a channel output still moves towards its setpoint.
+        PWMOUT_SLEW_CLAMPED marks the wehnelt held back by the wehnelt /
+        cathode clamp, PWMOUT_SLEW_WAVEFORM a channel driven by the
+        waveform player. etaMillis estimates the time till the output
+        reaches the setpoint (for a clamped wehnelt at least the time the
+        cathode still needs). Channels that have been slewing and settled
+        are collected for pwmoutSlewPollDone.
+*/
+#define PWMOUT_SLEW_IDLE                    0
+#define PWMOUT_SLEW_UP                      1
+#define PWMOUT_SLEW_DOWN                    2
+#define PWMOUT_SLEW_CLAMPED                 3
+#define PWMOUT_SLEW_WAVEFORM                4
+
+struct pwmoutSlewStatus {
+    uint8_t                     state;
+    uint16_t                    onCycles;       /* Currently output */
+    uint16_t                    target;         /* Setpoint in on cycles */
+    uint32_t                    etaMillis;
+};
+
+bool pwmoutSlewGetStatus(
+    uint8_t channel,
+    struct pwmoutSlewStatus* lpOut
+);
+/*
+    Returns the channels (bit n: channel n) that settled since the last
+    call
+*/
+pwmoutMask pwmoutSlewPollDone();
+
+bool pwmoutCalibrationSetScale(
+    uint8_t channel,
+    uint32_t scaleQ16
+);
+/*
+    Stores point index (value, on cycles in 1/64) of the table of a channel.
+    Points only become active with pwmoutCalibrationSetPointCount
+*/
+bool pwmoutCalibrationSetPoint(
+    uint8_t channel,
+    uint8_t index,
+    uint16_t value,
+    uint16_t onCycles64
+);
+/*
+    Activates the first count points of the table (0 or 1 selects the
+    linear scale). Values have to be strictly and on cycles monotonically
+    increasing, otherwise false is returned and the table is disabled
+*/
+bool pwmoutCalibrationSetPointCount(
+    uint8_t channel,
+    uint8_t count
+);
 
 void setPSUVolts(
     uint16_t v,
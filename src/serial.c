@@ -15,6 +15,8 @@
 
 static void adcCalibrateHVPS_Volts();
 static void adcCalibrateHVPS_Amps();
+static void rampMessage_OvercurrentTrip_Write(volatile struct ringBuffer* lpTX, struct adcTripStatus* lpTrip);
+static void rampMessage_LimitEvent_Write(volatile struct ringBuffer* lpTX, uint8_t psuMask);
 
 static volatile unsigned long int dwFilament__SetCurrent;
 static volatile bool bFilament__EnableCurrent;
@@ -31,23 +33,23 @@ static volatile bool bFilament__EnableCurrent;
                          <-> 0.0009765625 mA = 0.9765625 uA
 */
 /*@
-    requires (adcCounts >= 0) && (adcCounts < 1024);
+    requires (adcCounts >= 0) && (adcCounts < (1 << ADC_OVERSAMPLED_BITS));
 */
 static inline uint16_t serialADC2VoltsHCP(
     uint16_t adcCounts,
     uint8_t channel
 ) {
-    return (uint16_t)(((double)(adcCounts)) * cfgOptions.psuADCCalibration.channel[(channel-1)*2].k + cfgOptions.psuADCCalibration.channel[(channel-1)*2].d);
+    return adcCalibratedValue((channel-1)*2, adcCounts);
 }
 /*@
-    requires (adcCounts >= 0) && (adcCounts < 1024);
+    requires (adcCounts >= 0) && (adcCounts < (1 << ADC_OVERSAMPLED_BITS));
     assigns \nothing;
 */
 static inline uint16_t serialADC2TenthMicroampsHCP(
     uint16_t adcCounts,
     uint8_t channel
 ) {
-    return (uint16_t)(((double)(adcCounts)) * cfgOptions.psuADCCalibration.channel[(channel-1)*2 + 1].k + cfgOptions.psuADCCalibration.channel[(channel-1)*2 + 1].d);
+    return adcCalibratedValue((channel-1)*2 + 1, adcCounts);
     /* return (uint16_t)((double)(adcCounts) * 9.765625); */
 }
 static inline uint16_t serialADC2MilliampsFILA(
@@ -651,8 +653,10 @@ void serialInit0() {
     ensures acsl_serialbuffer_valid(&serialRB0_RX);
 */
 ISR(USART0_RX_vect) {
+    SYSCLOCK_ISR_ENTER();
     ringBuffer_WriteChar(&serialRB0_RX, UDR0);
     serialRXFlag = 1;
+    SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_USART0_RX);
 }
 /*@
     requires acsl_serialbuffer_valid(&serialRB0_TX);
@@ -678,6 +682,7 @@ ISR(USART0_RX_vect) {
     complete behaviors dataAvail, noDataAvail;
 */
 ISR(USART0_UDRE_vect) {
+    SYSCLOCK_ISR_ENTER();
     if(ringBuffer_Available(&serialRB0_TX) == true) {
         /* Shift next byte to the outside world ... */
         UDR0 = ringBuffer_ReadChar(&serialRB0_TX);
@@ -693,6 +698,7 @@ ISR(USART0_UDRE_vect) {
         UDR0 = '$';
         UCSR0B = UCSR0B & (~(0x08 | 0x20));
     }
+    SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_USART0_UDRE);
 }
 
 
@@ -777,8 +783,10 @@ ISR(USART0_UDRE_vect) {
         ensures acsl_serialbuffer_valid(&serialRB1_RX);
     */
     ISR(USART1_RX_vect) {
+        SYSCLOCK_ISR_ENTER();
         ringBuffer_WriteChar(&serialRB1_RX, UDR1);
         serialRX1Flag = 1;
+        SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_USART1_RX);
     }
     /*@
         requires acsl_serialbuffer_valid(&serialRB1_TX);
@@ -804,6 +812,7 @@ ISR(USART0_UDRE_vect) {
         complete behaviors dataAvail, noDataAvail;
     */
     ISR(USART1_UDRE_vect) {
+        SYSCLOCK_ISR_ENTER();
         if(ringBuffer_Available(&serialRB1_TX) == true) {
             /* Shift next byte to the outside world ... */
             UDR1 = ringBuffer_ReadChar(&serialRB1_TX);
@@ -818,6 +827,7 @@ ISR(USART0_UDRE_vect) {
             */
             UCSR1B = UCSR1B & (~(0x08 | 0x20));
         }
+        SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_USART1_UDRE);
     }
 #endif
 
@@ -903,8 +913,10 @@ void serialInit2() {
     complete behaviors gotQ, ignoreOtherThanQ;
 */
 ISR(USART2_RX_vect) {
+    SYSCLOCK_ISR_ENTER();
     ringBuffer_WriteChar(&serialRB2_RX, UDR2);
     serialRX2Flag = 1;
+    SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_USART2_RX);
 }
     /*@
         requires acsl_serialbuffer_valid(&serialRB2_TX);
@@ -930,6 +942,7 @@ ISR(USART2_RX_vect) {
         complete behaviors dataAvail, noDataAvail;
     */
 ISR(USART2_UDRE_vect) {
+    SYSCLOCK_ISR_ENTER();
     if(ringBuffer_Available(&serialRB2_TX) == true) {
         /* Shift next byte to the outside world ... */
         UDR2 = ringBuffer_ReadChar(&serialRB2_TX);
@@ -946,6 +959,7 @@ ISR(USART2_UDRE_vect) {
         UDR2 = '$';
         UCSR2B = UCSR2B & (~(0x08 | 0x20));
     }
+    SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_USART2_UDRE);
 }
 
 /*
@@ -1146,6 +1160,1306 @@ static unsigned char handleSerial0Messages_Response__GETBEAMCURLIM[] = "$$$beamc
 static unsigned char handleSerial0Messages_Response__GETINSULCURLIM[] = "$$$insulcurlim";
 static unsigned char handleSerial0Messages_Response__GETRAMPSTEPSIZES[] = "$$$rampsteps";
 static unsigned char handleSerial0Messages_Response__GETSTEPDURATIONS[] = "$$$rampdurations";
+static unsigned char handleSerial0Messages_Response__ADCDECIMATION[] = "$$$adcdecimation:";
+static unsigned char handleSerial0Messages_Response__ADC_Part[] = "$$$adc";
+static unsigned char handleSerial0Messages_Response__ADCSCAN[] = "$$$adcscan";
+static unsigned char handleSerial0Messages_Response__PSUFILTER[] = "$$$psufilter";
+static unsigned char handleSerial0Messages_Response__PWMMODE[] = "$$$pwmmode";
+static unsigned char handleSerial0Messages_Response__PWMSLOPE[] = "$$$pwmslope";
+static unsigned char handleSerial0Messages_Response__PWMTRIM_Part[] = "$$$pwmtrim";
+static unsigned char handleSerial0Messages_Response__WAVE_Part[] = "$$$wave";
+static unsigned char handleSerial0Messages_Response__PSUSTAGE[] = "$$$psustage:";
+static unsigned char handleSerial0Messages_Response__PWMSCALE[] = "$$$pwmscale";
+static unsigned char handleSerial0Messages_Response__BLANKTRIG[] = "$$$blanktrig:";
+static unsigned char handleSerial0Messages_Response__SLEW[] = "$$$slew:";
+static unsigned char handleSerial0Messages_Response__SLEW_Part[] = "$$$slew";
+static unsigned char handleSerial0Messages_Response__CCLATCH_Part[] = "$$$cclatch";
+static unsigned char handleSerial0Messages_Response__PROTECTION_Part[] = "$$$protection";
+static unsigned char handleSerial0Messages_Response__PWMPWL_Part[] = "$$$pwmpwl";
+
+/*
+    =======================================================
+    = Shared command implementations for USART0 and USART1 =
+    =======================================================
+
+    Each of these routines writes its complete response into the
+    passed TX ringbuffer. The caller is responsible for starting the
+    transmitter afterwards.
+*/
+
+/*@
+    assigns \nothing;
+
+    ensures ((\result >= 0) && (\result < 16)) || (\result == 0xFF);
+*/
+static uint8_t strASCIIHexDigit(
+    uint8_t c
+) {
+    if((c >= 0x30) && (c <= 0x39)) { return c - 0x30; }
+    if((c >= 0x61) && (c <= 0x66)) { return c - 0x61 + 10; }
+    if((c >= 0x41) && (c <= 0x46)) { return c - 0x41 + 10; }
+    return 0xFF;
+}
+
+/*
+    Parses up to dwMaxFields ':' separated decimal numbers into lpOut.
+    Returns the number of fields or 0xFF if the argument contains other
+    characters or too many fields. An empty argument contains no field
+*/
+/*@
+    requires \valid(&(lpStr[0 .. dwLen-1]));
+    requires \valid(&(lpOut[0 .. dwMaxFields-1]));
+    assigns lpOut[0 .. dwMaxFields-1];
+*/
+static uint8_t strASCIIToDecimalFields(
+    uint8_t* lpStr,
+    unsigned long int dwLen,
+    uint32_t* lpOut,
+    uint8_t dwMaxFields
+) {
+    unsigned long int i;
+    uint8_t dwFields;
+
+    if(dwLen == 0) {
+        return 0;
+    }
+    if(dwMaxFields == 0) {
+        return 0xFF;
+    }
+
+    dwFields = 1;
+    lpOut[0] = 0;
+
+    for(i = 0; i < dwLen; i=i+1) {
+        if((lpStr[i] >= 0x30) && (lpStr[i] <= 0x39)) {
+            lpOut[dwFields-1] = lpOut[dwFields-1] * 10 + (lpStr[i] - 0x30);
+        } else if(lpStr[i] == ':') {
+            if(dwFields == dwMaxFields) {
+                return 0xFF;
+            }
+            lpOut[dwFields] = 0;
+            dwFields = dwFields + 1;
+        } else {
+            return 0xFF;
+        }
+    }
+
+    return dwFields;
+}
+
+static void ringBuffer_WriteASCIIHex16(
+    volatile struct ringBuffer* lpTX,
+    uint16_t value
+) {
+    uint8_t i;
+    uint8_t nibble;
+
+    for(i = 0; i < 4; i=i+1) {
+        nibble = (value >> 12) & 0x0F;
+        ringBuffer_WriteChar(lpTX, (nibble < 10) ? (0x30 + nibble) : (0x61 + nibble - 10));
+        value = value << 4;
+    }
+}
+
+/*
+    adcdecimation       Queries the number of conversions per published value
+    adcdecimation[n]    Sets decimation (1, 4, 16 or 64)
+*/
+static void serialCommand_ADCDecimation(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    if(dwArgLen > 0) {
+        uint32_t newDecimation = strASCIIToDecimal(lpArg, dwArgLen);
+        if((newDecimation > 64) || (adcSetDecimation((uint8_t)newDecimation) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+        cfgOptions.adc.decimation = (uint8_t)newDecimation;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ADCDECIMATION, sizeof(handleSerial0Messages_Response__ADCDECIMATION)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, adcGetDecimation());
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    adcscan             Queries the scan weights of all ADC channels:
+                        $$$adcscan:[w0]:[w1]:...:[w15]
+    adcscan[c][w]       Sets the weight of channel c (hex digit) to w
+                        (0, 1, 2 or 4 conversions per scan table pass)
+*/
+static void serialCommand_ADCScan(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint8_t weights[ADC_CHANNEL_COUNT];
+    unsigned long int i;
+
+    adcGetScanWeights(weights);
+
+    if(dwArgLen > 0) {
+        uint8_t channel = (dwArgLen >= 2) ? strASCIIHexDigit(lpArg[0]) : 0xFF;
+        uint32_t newWeight = strASCIIToDecimal(&(lpArg[1]), dwArgLen-1);
+
+        if((channel >= ADC_CHANNEL_COUNT) || (newWeight > ADC_SCANWEIGHT_MAX)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+        weights[channel] = (uint8_t)newWeight;
+        if(adcSetScanWeights(weights) != true) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+        cfgOptions.adc.scanWeights[channel] = (uint8_t)newWeight;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ADCSCAN, sizeof(handleSerial0Messages_Response__ADCSCAN)-1);
+    for(i = 0; i < ADC_CHANNEL_COUNT; i=i+1) {
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, weights[i]);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    psufilter           Queries filter mode and EMA shift of all PSU readouts:
+                        $$$psufilter:[m0],[s0]:[m1],[s1]:...:[m7],[s7]
+    psufilter[c]:[m]:[s]
+                        Sets filter mode m (0: none, 1: EMA, 2: 3 tap median,
+                        3: 5 tap median) and EMA shift s of filter channel c
+                        (2*PSU: voltage, 2*PSU+1: current)
+*/
+static void serialCommand_PSUFilter(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[3];
+    uint8_t dwFields;
+    unsigned long int i;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 3);
+    if(dwFields == 3) {
+        if((fields[0] > 0xFF) || (fields[1] > 0xFF) || (fields[2] > 0xFF) || (psuFilterConfigure((uint8_t)fields[0], (uint8_t)fields[1], (uint8_t)fields[2]) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    } else if(dwFields != 0) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PSUFILTER, sizeof(handleSerial0Messages_Response__PSUFILTER)-1);
+    for(i = 0; i < PSU_FILTER_CHANNELS; i=i+1) {
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.psuFilter.mode[i]);
+        ringBuffer_WriteChar(lpTX, ',');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.psuFilter.emaShift[i]);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    pwmmode             Queries the output mode of all PWM channels:
+                        $$$pwmmode:[m0]:[m1]:...:[m7]
+    pwmmode[c]:[m]      Sets output mode m (0: PWM, 1: sigma-delta) of
+                        PWM channel c (2*PSU: voltage, 2*PSU+1: current)
+*/
+static void serialCommand_PWMMode(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[2];
+    uint8_t dwFields;
+    unsigned long int i;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 2);
+    if(dwFields == 2) {
+        if((fields[0] > 0xFF) || (fields[1] > 0xFF) || (pwmoutSetMode((uint8_t)fields[0], (uint8_t)fields[1]) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    } else if(dwFields != 0) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PWMMODE, sizeof(handleSerial0Messages_Response__PWMMODE)-1);
+    for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.pwmout.mode[i]);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    pwmslope            Queries the slope limit of all PWM channels:
+                        $$$pwmslope:[s0]:[s1]:...:[s7]
+    pwmslope[c]:[s]     Sets the slope limit of PWM channel c to s on cycles
+                        per slope update (0: unlimited)
+*/
+static void serialCommand_PWMSlope(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[2];
+    uint8_t dwFields;
+    unsigned long int i;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 2);
+    if(dwFields == 2) {
+        if((fields[0] > 0xFF) || (fields[1] > 0xFFFF) || (pwmoutSetSlope((uint8_t)fields[0], (uint16_t)fields[1]) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    } else if(dwFields != 0) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PWMSLOPE, sizeof(handleSerial0Messages_Response__PWMSLOPE)-1);
+    for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.pwmout.slope[i]);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    pwmtrim[p]          Queries the closed loop voltage trim of PSU p:
+                        $$$pwmtrim[p]:[enable]:[gain]:[clamp]:[trim]
+                        with the current trim in 1/256 on cycles (signed)
+    pwmtrim[p]:[e]:[g]:[c]
+                        Enables (e = 1) or disables the trim, gain g in 1/256
+                        on cycles per volt and step, clamp c in on cycles
+*/
+static void serialCommand_PWMTrim(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[4];
+    uint8_t dwFields;
+    int32_t trim;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 4);
+    if((dwFields != 1) && (dwFields != 4)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    if((fields[0] < 1) || (fields[0] > PSU_COUNT)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    if(dwFields == 4) {
+        if((fields[1] > 1) || (fields[2] > 0xFFFF) || (fields[3] > 0xFFFF) || (pwmoutTrimConfigure((uint8_t)fields[0], (fields[1] != 0) ? true : false, (uint16_t)fields[2], (uint16_t)fields[3]) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PWMTRIM_Part, sizeof(handleSerial0Messages_Response__PWMTRIM_Part)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, fields[0]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, ((cfgOptions.voltageTrim.enable & (0x01 << (fields[0] - 1))) != 0) ? 1 : 0);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.voltageTrim.gain[fields[0] - 1]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.voltageTrim.clamp[fields[0] - 1]);
+    ringBuffer_WriteChar(lpTX, ':');
+    trim = pwmoutTrimGet((uint8_t)fields[0]);
+    if(trim < 0) {
+        ringBuffer_WriteChar(lpTX, '-');
+        trim = -trim;
+    }
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, (unsigned long int)trim);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    wavepoint[i]:[c]:[v]:[d]
+                        Stores point i of the waveform table for PWM channel c
+                        with setpoint v (volts or microamps) and dwell time d
+                        in timer ticks (48 us)
+    wavestart[c]:[f]:[n]:[l]
+                        Plays points f ... f+n-1 on channel c, l times (0:
+                        until stopped)
+    wavestop[c]         Stops playback on channel c
+    wavestatus[c]       Returns $$$wave[c]:[state]:[point]:[loops left]
+                        (state 0: idle, 1: running, 2: done)
+*/
+static void serialCommand_WavePoint(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[4];
+
+    if((strASCIIToDecimalFields(lpArg, dwArgLen, fields, 4) != 4) || (fields[0] > 0xFF) || (fields[1] > 0xFF) || (fields[2] > 0xFFFF) || (fields[3] > 0xFFFF)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    if(pwmoutWaveformSetPoint((uint8_t)fields[0], (uint8_t)fields[1], (uint16_t)fields[2], (uint16_t)fields[3]) != true) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+    }
+}
+
+static void serialCommand_WaveStart(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[4];
+
+    if((strASCIIToDecimalFields(lpArg, dwArgLen, fields, 4) != 4) || (fields[0] > 0xFF) || (fields[1] > 0xFF) || (fields[2] > 0xFF) || (fields[3] > 0xFFFF)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    if(pwmoutWaveformStart((uint8_t)fields[0], (uint8_t)fields[1], (uint8_t)fields[2], (uint16_t)fields[3]) != true) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+    }
+}
+
+static void serialCommand_WaveStop(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[1];
+
+    if((strASCIIToDecimalFields(lpArg, dwArgLen, fields, 1) != 1) || (fields[0] >= PWMOUT_CHANNELS)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    pwmoutWaveformStop((uint8_t)fields[0]);
+}
+
+static void serialCommand_WaveStatus(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[1];
+    struct pwmoutWaveformStatus status;
+
+    if((strASCIIToDecimalFields(lpArg, dwArgLen, fields, 1) != 1) || (fields[0] > 0xFF) || (pwmoutWaveformGetStatus((uint8_t)fields[0], &status) != true)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__WAVE_Part, sizeof(handleSerial0Messages_Response__WAVE_Part)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, fields[0]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, status.state);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, status.index);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, status.loopsLeft);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    psustagev[p]:[v]    Stages voltage v of PSU p
+    psustagea[p]:[ua]   Stages current limit ua of PSU p
+    psucommit           Applies all staged setpoints together at the next
+                        PWM period boundary
+    psucommitv[v1]:[v2]:...
+                        Stages the voltages of all PSU_COUNT PSUs and commits
+    psustage            Returns the bit mask of staged channels (bit 2*p-2
+                        voltage, 2*p-1 current of PSU p): $$$psustage:[mask]
+    psustageclear       Discards all staged setpoints
+*/
+static void serialCommand_PSUStage(
+    volatile struct ringBuffer* lpTX,
+    bool bVoltage,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[2];
+    bool bOk;
+
+    if((strASCIIToDecimalFields(lpArg, dwArgLen, fields, 2) != 2) || (fields[0] > 0xFF) || (fields[1] > 0xFFFF)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    if(bVoltage == true) {
+        bOk = pwmoutStageVolts((uint16_t)fields[1], (uint8_t)fields[0]);
+    } else {
+        bOk = pwmoutStageMicroamps((uint16_t)fields[1], (uint8_t)fields[0]);
+    }
+    if(bOk != true) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+    }
+}
+
+static void serialCommand_PSUCommitVolts(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[PSU_COUNT];
+    unsigned long int i;
+
+    if(strASCIIToDecimalFields(lpArg, dwArgLen, fields, PSU_COUNT) != PSU_COUNT) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        if(fields[i] > 0xFFFF) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    }
+
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        pwmoutStageVolts((uint16_t)fields[i], i+1);
+    }
+    pwmoutCommit();
+}
+
+/*
+    pwmscale            Queries the linear conversion scale of all PWM
+                        channels (on cycles per volt or microamp, Q16):
+                        $$$pwmscale:[s0]:[s1]:...:[s7]
+    pwmscale[c]:[s]     Sets the scale of channel c
+*/
+static void serialCommand_PWMScale(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[2];
+    uint8_t dwFields;
+    unsigned long int i;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 2);
+    if(dwFields == 2) {
+        if((fields[0] > 0xFF) || (pwmoutCalibrationSetScale((uint8_t)fields[0], fields[1]) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    } else if(dwFields != 0) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PWMSCALE, sizeof(handleSerial0Messages_Response__PWMSCALE)-1);
+    for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.pwmout.scale[i]);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    blanktrig           Queries the external blanking trigger mode and the
+                        blanking state: $$$blanktrig:[mode]:[blanked]
+    blanktrig[m]        Sets the trigger mode (0: off, 1: high blanks,
+                        2: low blanks)
+*/
+static void serialCommand_BlankTrigger(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[1];
+    uint8_t dwFields;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 1);
+    if(dwFields == 1) {
+        if((fields[0] > 0xFF) || (pwmoutBlankSetTrigger((uint8_t)fields[0]) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    } else if(dwFields != 0) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__BLANKTRIG, sizeof(handleSerial0Messages_Response__BLANKTRIG)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.blanking.trigger);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, (pwmoutBlankIsBlanked() == true) ? 1 : 0);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    slew                Returns the slew state of all channels as one digit
+                        per channel (0: idle, 1: up, 2: down, 3: clamped by
+                        the wehnelt / cathode limit, 4: waveform) and the
+                        time till all channels settled in milliseconds:
+                        $$$slew:[s0 ... s7]:[eta]
+    slew[c]             Returns the state of channel c with current and
+                        target on cycles: $$$slew[c]:[s]:[on]:[target]:[eta]
+*/
+static void serialCommand_Slew(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[1];
+    uint8_t dwFields;
+    struct pwmoutSlewStatus status;
+    uint32_t etaMax = 0;
+    unsigned long int i;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 1);
+    if(dwFields == 1) {
+        if((fields[0] > 0xFF) || (pwmoutSlewGetStatus((uint8_t)fields[0], &status) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__SLEW_Part, sizeof(handleSerial0Messages_Response__SLEW_Part)-1);
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, fields[0]);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, status.state);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, status.onCycles);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, status.target);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, status.etaMillis);
+        ringBuffer_WriteChar(lpTX, 0x0A);
+        return;
+    } else if(dwFields != 0) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__SLEW, sizeof(handleSerial0Messages_Response__SLEW)-1);
+    for(i = 0; i < PWMOUT_CHANNELS; i=i+1) {
+        pwmoutSlewGetStatus(i, &status);
+        ringBuffer_WriteChar(lpTX, '0' + status.state);
+        if((status.state != PWMOUT_SLEW_WAVEFORM) && (status.etaMillis > etaMax)) {
+            etaMax = status.etaMillis;
+        }
+    }
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, etaMax);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    cclatch             Returns the current limit event counters of all PSUs
+                        in the format of the asynchronous event:
+                        $$$ccevent:0:[n1]:[n2]:[n3]:[n4]
+    cclatch[p]          Returns count and the micros() timestamps of the last
+                        transition into and out of current limit of PSU p
+                        (1 ... 4): $$$cclatch[p]:[count]:[entry]:[exit]
+*/
+static void serialCommand_CCLatch(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[1];
+    uint8_t dwFields;
+    struct psuLimitLatch latch;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 1);
+    if(dwFields == 0) {
+        rampMessage_LimitEvent_Write(lpTX, 0);
+        return;
+    }
+    if((dwFields != 1) || (fields[0] < 1) || (fields[0] > PSU_COUNT)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    psuLimitGetLatch(fields[0] - 1, &latch);
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__CCLATCH_Part, sizeof(handleSerial0Messages_Response__CCLATCH_Part)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, fields[0]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, latch.count);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, latch.entryMicros);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, latch.exitMicros);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    protection[p]       Returns the protection policy of PSU p (1 ... 4):
+                        $$$protection[p]:[samples]:[us]:[ua]:[arcs]
+    protection[p]:[samples]:[us]:[ua]:[arcs]
+                        Sets consecutive current limit observations, time in
+                        current limit (us), current threshold (uA) and arcs
+                        per minute that trip PSU p (0 disables a rule) and
+                        echoes the policy
+*/
+static void serialCommand_Protection(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[5];
+    uint8_t dwFields;
+    uint8_t psuIndex;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 5);
+    if(((dwFields != 1) && (dwFields != 5)) || (fields[0] < 1) || (fields[0] > PSU_COUNT)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    psuIndex = fields[0] - 1;
+
+    if(dwFields == 5) {
+        if((fields[1] > 0xFF) || (fields[3] > 0xFFFF) || (fields[4] > 0xFF) || (controllerProtectionConfigure(psuIndex, fields[1], fields[2], fields[3], fields[4]) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PROTECTION_Part, sizeof(handleSerial0Messages_Response__PROTECTION_Part)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, fields[0]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.protection.ccSamples[psuIndex]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.protection.ccMicros[psuIndex]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.protection.currentLimit[psuIndex]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.protection.arcsPerMinute[psuIndex]);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    psugetv[n]          Returns the voltage of PSU n (1 ... PSU_COUNT) in V:
+                        $$$v[n]:[volts]
+    psugeta[n]          Returns the current of PSU n in 0.1 uA: $$$a[n]:[value]
+    psupol[n][p|n]      Requests positive or negative polarity of PSU n. The
+                        relay is switched by the polarity sequencer after
+                        the output discharged, completion is reported as
+                        $$$poldone:[n]:[p|n] ($$$poldone:[n]:f on failure)
+    psusetv[n][v]       Sets the voltage of PSU n in V
+    psuseta[n][ua]      Sets the current limit of PSU n
+
+    The PSU number is the single digit following the command. Setting a
+    PSU stops a running ramp
+*/
+static uint8_t serialPSUIndex(
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    if((dwArgLen < 1) || (lpArg[0] < '1') || (lpArg[0] > ('0' + PSU_COUNT))) {
+        return 0xFF;
+    }
+    return lpArg[0] - '1';
+}
+
+static void serialCommand_PSUGet(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen,
+    bool bVoltage
+) {
+    uint8_t psuIndex = serialPSUIndex(lpArg, dwArgLen);
+
+    if((psuIndex == 0xFF) || (dwArgLen != 1)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    if(bVoltage == true) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
+    } else {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
+    }
+    ringBuffer_WriteChar(lpTX, '1' + psuIndex);
+    ringBuffer_WriteChar(lpTX, ':');
+    if(bVoltage == true) {
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, serialADC2VoltsHCP(psuStates[psuIndex].realV, psuIndex + 1));
+    } else {
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, serialADC2TenthMicroampsHCP(psuStates[psuIndex].realI, psuIndex + 1));
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+static void serialCommand_PSUPolarity(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint8_t psuIndex = serialPSUIndex(lpArg, dwArgLen);
+
+    if((psuIndex == 0xFF) || (dwArgLen != 2) || ((lpArg[1] != 'p') && (lpArg[1] != 'n'))) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    /* Switched by the polarity sequencer once the output is discharged */
+    if(controllerPolarityRequest(psuIndex, (lpArg[1] == 'n') ? true : false) != true) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    rampMode.mode = controllerRampMode__None;
+}
+
+static void serialCommand_PSUSet(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen,
+    bool bVoltage
+) {
+    uint8_t psuIndex = serialPSUIndex(lpArg, dwArgLen);
+
+    if(psuIndex == 0xFF) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    if(bVoltage == true) {
+        setPSUVolts(strASCIIToDecimal(&(lpArg[1]), dwArgLen-1), psuIndex + 1);
+    } else {
+        setPSUMicroamps(strASCIIToDecimal(&(lpArg[1]), dwArgLen-1), psuIndex + 1);
+    }
+    rampMode.mode = controllerRampMode__None;
+}
+
+/*
+    adcget[c]           Returns the oversampled value of ADC channel c (hex digit)
+                        together with the sequence number of the block:
+                        $$$adc[c]:[value]:[sequence]
+*/
+static void serialCommand_ADCGet(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint8_t channel;
+    struct adcSnapshot snap;
+
+    channel = (dwArgLen == 1) ? strASCIIHexDigit(lpArg[0]) : 0xFF;
+    if(channel >= ADC_CHANNEL_COUNT) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    adcGetSnapshot(&snap);
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ADC_Part, sizeof(handleSerial0Messages_Response__ADC_Part)-1);
+    ringBuffer_WriteChar(lpTX, lpArg[0]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, snap.values[channel]);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, snap.sequence);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    Deferred multi line reports
+
+    Some reports (ADC statistics, ...) are too large to fit into the TX
+    ringbuffer at once. They are registered with serialReport_Start and
+    emitted line by line by handleSerial0Messages / handleSerial1Messages
+    whenever the TX ringbuffer has space for another line. The line
+    callback returns false as soon as there is no more line to emit.
+    No line may be longer than SERIAL_REPORT_LINE_MAX characters.
+*/
+#define SERIAL_REPORT_LINE_MAX 56
+
+typedef bool (*lpfnSerialReportLine)(volatile struct ringBuffer* lpTX, uint8_t dwLine);
+
+struct serialReport {
+    lpfnSerialReportLine        lpfnLine;
+    uint8_t                     dwNextLine;
+};
+
+static struct serialReport serialReport0;
+#ifdef SERIAL_UART1_ENABLE
+    static struct serialReport serialReport1;
+#endif
+
+static void serialReport_Start(
+    struct serialReport* lpReport,
+    lpfnSerialReportLine lpfnLine
+) {
+    lpReport->lpfnLine = lpfnLine;
+    lpReport->dwNextLine = 0;
+}
+
+/*
+    Returns true if data has been written into the TX buffer (the caller
+    has to start the transmitter in this case)
+*/
+static bool serialReport_Pump(
+    struct serialReport* lpReport,
+    volatile struct ringBuffer* lpTX
+) {
+    bool bWritten = false;
+
+    /*@
+        loop assigns lpReport->dwNextLine;
+        loop assigns lpReport->lpfnLine;
+    */
+    while((lpReport->lpfnLine != NULL) && (ringBuffer_WriteableN(lpTX) > SERIAL_REPORT_LINE_MAX)) {
+        if(lpReport->lpfnLine(lpTX, lpReport->dwNextLine) != true) {
+            lpReport->lpfnLine = NULL;
+        } else {
+            lpReport->dwNextLine = lpReport->dwNextLine + 1;
+            bWritten = true;
+        }
+    }
+
+    return bWritten;
+}
+
+/*
+    adcstats            Fetches and atomically resets the statistics of all
+                        channels. One line per channel is reported:
+                        $$$adcstat[c]:[min]:[max]:[mean]:[count]
+                        min and max are raw 10 bit values, mean is normalized
+                        to ADC_OVERSAMPLED_BITS
+    adcstatwindow[n]    Sets the statistics window in samples (0: until fetched)
+*/
+static unsigned char handleSerial0Messages_Response__ADCSTAT_Part[] = "$$$adcstat";
+static unsigned char handleSerial0Messages_Response__ADCSTATWINDOW[] = "$$$adcstatwindow:";
+static struct adcStatistics serialADCStatistics[ADC_CHANNEL_COUNT];
+
+static bool serialReportLine_ADCStatistics(
+    volatile struct ringBuffer* lpTX,
+    uint8_t dwLine
+) {
+    uint32_t mean = 0;
+
+    if(dwLine >= ADC_CHANNEL_COUNT) {
+        return false;
+    }
+
+    if(serialADCStatistics[dwLine].count != 0) {
+        mean = (serialADCStatistics[dwLine].sum << (ADC_OVERSAMPLED_BITS - 10)) / serialADCStatistics[dwLine].count;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ADCSTAT_Part, sizeof(handleSerial0Messages_Response__ADCSTAT_Part)-1);
+    ringBuffer_WriteChar(lpTX, (dwLine < 10) ? (0x30 + dwLine) : (0x61 + dwLine - 10));
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, serialADCStatistics[dwLine].min);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, serialADCStatistics[dwLine].max);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, mean);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, serialADCStatistics[dwLine].count);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+
+    return true;
+}
+
+static void serialCommand_ADCStatistics(
+    struct serialReport* lpReport
+) {
+    adcStatisticsFetch(serialADCStatistics);
+    serialReport_Start(lpReport, &serialReportLine_ADCStatistics);
+}
+
+static void serialCommand_ADCStatisticsWindow(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    if(dwArgLen > 0) {
+        uint32_t newWindow = strASCIIToDecimal(lpArg, dwArgLen);
+        if(newWindow > 0xFFFF) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+        adcStatisticsSetWindow((uint16_t)newWindow);
+        cfgOptions.adc.statisticsWindow = (uint16_t)newWindow;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ADCSTATWINDOW, sizeof(handleSerial0Messages_Response__ADCSTATWINDOW)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, adcStatisticsGetWindow());
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+/*
+    adctracearm[m]:[p]      Arms the burst trace for all channels in the
+    adctracearm[m]:[p]:[c]:[t]:[f]
+                            decimal channel mask m keeping p entries before
+                            the trigger. Optionally triggers when channel c
+                            reaches raw value t (or falls to t if f is 1)
+    adctracetrig            Manual trigger
+    adctracestop            Stops a running capture
+    adctrace                Status: $$$adctrace:[state]:[source]:[count]:[trigger]
+    adctracedump[o]         Dumps up to 64 entries starting at offset o, four
+                            hex coded entries (channel in the first digit)
+                            per line: $$$adctd:[offset]:[e0]:[e1]:[e2]:[e3]
+*/
+#define SERIAL_ADCTRACE_DUMP_PER_LINE   4
+#define SERIAL_ADCTRACE_DUMP_LINES      16
+
+static unsigned char handleSerial0Messages_Response__ADCTRACE[] = "$$$adctrace:";
+static unsigned char handleSerial0Messages_Response__ADCTRACEDATA[] = "$$$adctd:";
+static uint16_t serialADCTraceDumpOffset;
+
+static void serialCommand_ADCTraceArm(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[5];
+    uint8_t dwFields;
+    uint8_t thresholdChannel = ADC_TRACE_THRESHOLD_DISABLED;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 5);
+    if((dwFields != 2) && (dwFields != 4) && (dwFields != 5)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    if(dwFields < 4) {
+        fields[2] = 0;
+        fields[3] = 0;
+    } else {
+        thresholdChannel = (fields[2] < ADC_CHANNEL_COUNT) ? (uint8_t)fields[2] : ADC_CHANNEL_COUNT;
+    }
+    if(dwFields < 5) {
+        fields[4] = 0;
+    }
+
+    if((fields[0] > 0xFFFF) || (fields[1] > ADC_TRACE_LENGTH) || (fields[3] > 0xFFFF) || (fields[4] > 1)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+    if(adcTraceArm((uint16_t)fields[0], (uint16_t)fields[1], thresholdChannel, (uint16_t)fields[3], (fields[4] != 0) ? true : false) != true) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+}
+
+static void serialCommand_ADCTraceStatus(
+    volatile struct ringBuffer* lpTX
+) {
+    struct adcTraceStatus status;
+
+    adcTraceGetStatus(&status);
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ADCTRACE, sizeof(handleSerial0Messages_Response__ADCTRACE)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, status.state);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, status.source);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, status.count);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, status.triggerIndex);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+static bool serialReportLine_ADCTraceDump(
+    volatile struct ringBuffer* lpTX,
+    uint8_t dwLine
+) {
+    uint16_t entries[SERIAL_ADCTRACE_DUMP_PER_LINE];
+    uint16_t dwOffset;
+    uint16_t dwCount;
+    uint16_t i;
+
+    if(dwLine >= SERIAL_ADCTRACE_DUMP_LINES) {
+        return false;
+    }
+
+    dwOffset = serialADCTraceDumpOffset + dwLine * SERIAL_ADCTRACE_DUMP_PER_LINE;
+    dwCount = adcTraceRead(dwOffset, entries, SERIAL_ADCTRACE_DUMP_PER_LINE);
+    if(dwCount == 0) {
+        return false;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ADCTRACEDATA, sizeof(handleSerial0Messages_Response__ADCTRACEDATA)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, dwOffset);
+    for(i = 0; i < dwCount; i=i+1) {
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIHex16(lpTX, entries[i]);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+
+    return true;
+}
+
+static void serialCommand_ADCTraceDump(
+    volatile struct ringBuffer* lpTX,
+    struct serialReport* lpReport,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    struct adcTraceStatus status;
+    uint32_t dwOffset = strASCIIToDecimal(lpArg, dwArgLen);
+
+    adcTraceGetStatus(&status);
+    if((status.state == ADC_TRACE_STATE_ARMED) || (status.state == ADC_TRACE_STATE_TRIGGERED) || (dwOffset >= status.count)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    serialADCTraceDumpOffset = (uint16_t)dwOffset;
+    serialReport_Start(lpReport, &serialReportLine_ADCTraceDump);
+}
+/*
+    pwmpwl[c]           Returns the number of active table points and the
+                        points of channel c (values in volts or microamps,
+                        on cycles in 1/64), one per line:
+                        $$$pwmpwl[c]:[count] followed by
+                        $$$pwmpwl[c]:[i]:[value]:[on cycles]
+    pwmpwl[c]:[n]       Activates the first n points (0: use scale)
+    pwmpwl[c]:[i]:[v]:[d]
+                        Stores point i of an inactive table
+*/
+static uint8_t serialPWMPwlChannel;
+
+static bool serialReportLine_PWMPwl(
+    volatile struct ringBuffer* lpTX,
+    uint8_t dwLine
+) {
+    if(dwLine > PWMOUT_PWL_POINTS) {
+        return false;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PWMPWL_Part, sizeof(handleSerial0Messages_Response__PWMPWL_Part)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, serialPWMPwlChannel);
+    ringBuffer_WriteChar(lpTX, ':');
+    if(dwLine == 0) {
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.pwmout.pwlCount[serialPWMPwlChannel]);
+    } else {
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, dwLine - 1);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.pwmout.pwlValue[serialPWMPwlChannel][dwLine - 1]);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, cfgOptions.pwmout.pwlOnCycles[serialPWMPwlChannel][dwLine - 1]);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+
+    return true;
+}
+
+static void serialCommand_PWMPwl(
+    volatile struct ringBuffer* lpTX,
+    struct serialReport* lpReport,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[4];
+    uint8_t dwFields;
+    bool bOk = false;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 4);
+    if((dwFields == 0) || (dwFields == 0xFF) || (fields[0] >= PWMOUT_CHANNELS)) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    if(dwFields == 1) {
+        serialPWMPwlChannel = (uint8_t)fields[0];
+        serialReport_Start(lpReport, &serialReportLine_PWMPwl);
+        return;
+    } else if(dwFields == 2) {
+        bOk = (fields[1] <= 0xFF) ? pwmoutCalibrationSetPointCount((uint8_t)fields[0], (uint8_t)fields[1]) : false;
+    } else if(dwFields == 4) {
+        bOk = ((fields[1] <= 0xFF) && (fields[2] <= 0xFFFF) && (fields[3] <= 0xFFFF)) ? pwmoutCalibrationSetPoint((uint8_t)fields[0], (uint8_t)fields[1], (uint16_t)fields[2], (uint16_t)fields[3]) : false;
+    }
+
+    if(bOk != true) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+    }
+}
+
+/*
+    profile             Reports the main loop profile (all times in us):
+                        $$$prof[s]:[min]:[max]:[avg]:[count] for every stage s
+                        (0: serial0, 1: serial1, 2: serial2, 3: PSU measurement,
+                        4: PSU outputs, 5: ramp, 6: overcurrent, 7: whole loop,
+                        8: voltage trim, 9: slew events, 10: polarity sequencer)
+                        followed by the loop time histogram (log2 bins):
+                        $$$profhist[n]:[bin 4n]:[bin 4n+1]:[bin 4n+2]:[bin 4n+3]
+    profilereset        Restarts profiling
+*/
+#define SERIAL_PROFILE_HISTOGRAM_PER_LINE 4
+
+static unsigned char handleSerial0Messages_Response__PROFILE_Part[] = "$$$prof";
+static unsigned char handleSerial0Messages_Response__PROFILEHIST_Part[] = "$$$profhist";
+static struct controllerProfile serialProfile;
+
+static bool serialReportLine_Profile(
+    volatile struct ringBuffer* lpTX,
+    uint8_t dwLine
+) {
+    unsigned long int i;
+
+    if(dwLine < CONTROLLER_PROFILE_STAGES) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PROFILE_Part, sizeof(handleSerial0Messages_Response__PROFILE_Part)-1);
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, dwLine);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, (serialProfile.stages[dwLine].count != 0) ? serialProfile.stages[dwLine].min : 0);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, serialProfile.stages[dwLine].max);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, (serialProfile.stages[dwLine].count != 0) ? (serialProfile.stages[dwLine].sum / serialProfile.stages[dwLine].count) : 0);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, serialProfile.stages[dwLine].count);
+        ringBuffer_WriteChar(lpTX, 0x0A);
+        return true;
+    }
+
+    dwLine = dwLine - CONTROLLER_PROFILE_STAGES;
+    if(dwLine >= (CONTROLLER_PROFILE_HISTOGRAM_BINS / SERIAL_PROFILE_HISTOGRAM_PER_LINE)) {
+        return false;
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PROFILEHIST_Part, sizeof(handleSerial0Messages_Response__PROFILEHIST_Part)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, dwLine);
+    for(i = 0; i < SERIAL_PROFILE_HISTOGRAM_PER_LINE; i=i+1) {
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, serialProfile.histogram[dwLine * SERIAL_PROFILE_HISTOGRAM_PER_LINE + i]);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+
+    return true;
+}
+
+static void serialCommand_Profile(
+    struct serialReport* lpReport
+) {
+    /* Copy so the report is consistent while the loop keeps profiling */
+    serialProfile = controllerProfile;
+    serialReport_Start(lpReport, &serialReportLine_Profile);
+}
+
+#ifdef SYSCLOCK_ISR_STATISTICS
+/*
+    isrstats            Reports ISR execution time accounting since the last
+                        report and restarts it. First line is the covered
+                        time in us ($$$isrwin:[us]), followed by one line per
+                        ISR n (0: ADC, 1: timer 0, 2: timer 2 (PWM), 3/4: USART0
+                        RX/UDRE, 5/6: USART1 RX/UDRE, 7/8: USART2 RX/UDRE,
+                        9: blanking trigger):
+                        $$$isr[n]:[count]:[max cycles]:[cycles]:[load permille]
+                        Only available in builds with "make ISRSTATS=1"
+*/
+static unsigned char handleSerial0Messages_Response__ISRWIN[] = "$$$isrwin:";
+static unsigned char handleSerial0Messages_Response__ISR_Part[] = "$$$isr";
+static struct sysclockISRStatistics serialISRStatistics[SYSCLOCK_ISR_COUNT];
+static unsigned long int serialISRStatisticsWindow;
+
+static bool serialReportLine_ISRStatistics(
+    volatile struct ringBuffer* lpTX,
+    uint8_t dwLine
+) {
+    unsigned long int permille = 0;
+
+    if(dwLine == 0) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ISRWIN, sizeof(handleSerial0Messages_Response__ISRWIN)-1);
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, serialISRStatisticsWindow);
+        ringBuffer_WriteChar(lpTX, 0x0A);
+        return true;
+    }
+
+    dwLine = dwLine - 1;
+    if(dwLine >= SYSCLOCK_ISR_COUNT) {
+        return false;
+    }
+
+    if(serialISRStatisticsWindow >= 1000) {
+        /* Cycles to microseconds, divided by window in milliseconds */
+        permille = (serialISRStatistics[dwLine].cycles / (F_CPU / 1000000L)) / (serialISRStatisticsWindow / 1000);
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ISR_Part, sizeof(handleSerial0Messages_Response__ISR_Part)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, dwLine);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, serialISRStatistics[dwLine].count);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, serialISRStatistics[dwLine].maxCycles);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, serialISRStatistics[dwLine].cycles);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, permille);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+
+    return true;
+}
+
+static void serialCommand_ISRStatistics(
+    struct serialReport* lpReport
+) {
+    serialISRStatisticsWindow = sysclockISRStatisticsFetch(serialISRStatistics);
+    serialReport_Start(lpReport, &serialReportLine_ISRStatistics);
+}
+#endif
+
+/*
+    pwmprofile          Returns the active PWM profile with its resolution
+                        and tick: $$$pwmprofile:[p]:[bits]:[tick us]
+    pwmprofile[p]       Activates profile p
+    pwmbench            Reports the load of the timer 2 (PWM) ISR since the
+                        last pwmbench or isrstats query and restarts ISR
+                        accounting (shared with isrstats):
+                        $$$pwmbench:[p]:[us]:[count]:[max]:[avg]:[load]
+                        with cycles per ISR and load in permille. Only
+                        available in builds with "make ISRSTATS=1"
+*/
+static unsigned char handleSerial0Messages_Response__PWMPROFILE[] = "$$$pwmprofile:";
+static unsigned char handleSerial0Messages_Response__PWMBENCH[] = "$$$pwmbench:";
+
+static void serialCommand_PWMProfile(
+    volatile struct ringBuffer* lpTX,
+    uint8_t* lpArg,
+    unsigned long int dwArgLen
+) {
+    uint32_t fields[1];
+    uint8_t dwFields;
+    struct pwmoutProfileInfo info;
+
+    dwFields = strASCIIToDecimalFields(lpArg, dwArgLen, fields, 1);
+    if(dwFields == 1) {
+        if((fields[0] > 0xFF) || (pwmoutSetProfile((uint8_t)fields[0]) != true)) {
+            ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+            return;
+        }
+    } else if(dwFields != 0) {
+        ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__ERR, sizeof(handleSerial0Messages_Response__ERR)-1);
+        return;
+    }
+
+    pwmoutGetProfileInfo(pwmoutGetProfile(), &info);
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PWMPROFILE, sizeof(handleSerial0Messages_Response__PWMPROFILE)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, pwmoutGetProfile());
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, info.bits);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, info.tickMicros);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+#ifdef SYSCLOCK_ISR_STATISTICS
+static void serialCommand_PWMBench(
+    volatile struct ringBuffer* lpTX
+) {
+    struct sysclockISRStatistics* lpStat = &(serialISRStatistics[SYSCLOCK_ISR_TIMER2_COMPA]);
+    unsigned long int permille = 0;
+
+    serialISRStatisticsWindow = sysclockISRStatisticsFetch(serialISRStatistics);
+    if(serialISRStatisticsWindow >= 1000) {
+        permille = (lpStat->cycles / (F_CPU / 1000000L)) / (serialISRStatisticsWindow / 1000);
+    }
+
+    ringBuffer_WriteChars(lpTX, handleSerial0Messages_Response__PWMBENCH, sizeof(handleSerial0Messages_Response__PWMBENCH)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, pwmoutGetProfile());
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, serialISRStatisticsWindow);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, lpStat->count);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, lpStat->maxCycles);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, (lpStat->count != 0) ? (lpStat->cycles / lpStat->count) : 0);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, permille);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+#endif
 
 /*@
     requires \valid(&serialRB0_RX);
@@ -1166,178 +2480,58 @@ static void handleSerial0Messages_CompleteMessage(
         We have received a complete message - now we will remove the sync
         pattern, calculate actual length
     */
-    ringBuffer_discardN(&serialRB0_RX, 3); /* Skip sync pattern */
-    dwLen = dwLength - 3;
-    //@ assert dwLen > 2;
-
-    /* Remove end of line for next parser ... */
-    dwLen = dwLen - 1; /* Remove LF */
-    //@ assert dwLen > 0;
-    dwLen = dwLen - ((ringBuffer_PeekCharN(&serialRB0_RX, dwLen-1) == 0x0D) ? 1 : 0); /* Remove CR if present */
-    //@ assert dwLen >= 0;
-
-    /* Now copy message into a local buffer to make parsing WAY easier ... */
-    ringBuffer_ReadChars(&serialRB0_RX, handleSerial0Messages_StringBuffer, dwLen);
-
-    /*
-        Now process that message at <handleSerial0Messages_StringBuffer, dwLen>
-    */
-
-    /*
-        Parse different commands
-    */
-    if(strCompare("id", 2, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        /* Send ID response ... */
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__ID, sizeof(handleSerial0Messages_Response__ID)-1);
-        serialModeTX0();
-        filamentCurrent_GetId();
-        filamentCurrent_GetVersion();
-    } else if(strCompare("psugetv1", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        uint16_t v;
-        {
-            cli();
-            v = currentADC[0];
-            sei();
-        }
-        v = serialADC2VoltsHCP(v, 1);
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
-        ringBuffer_WriteChar(&serialRB0_TX, '1');
-        ringBuffer_WriteChar(&serialRB0_TX, ':');
-        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, v);
-        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
-        serialModeTX0();
-    } else if(strCompare("psugetv2", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        uint16_t v;
-        {
-            cli();
-            v = currentADC[2];
-            sei();
-        }
-        v = serialADC2VoltsHCP(v, 2);
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
-        ringBuffer_WriteChar(&serialRB0_TX, '2');
-        ringBuffer_WriteChar(&serialRB0_TX, ':');
-        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, v);
-        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
-        serialModeTX0();
-    } else if(strCompare("psugetv3", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        uint16_t v;
-        {
-            cli();
-            v = currentADC[4];
-            sei();
-        }
-        v = serialADC2VoltsHCP(v, 3);
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
-        ringBuffer_WriteChar(&serialRB0_TX, '3');
-        ringBuffer_WriteChar(&serialRB0_TX, ':');
-        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, v);
-        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
-        serialModeTX0();
-    } else if(strCompare("psugetv4", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        uint16_t v;
-        {
-            cli();
-            v = currentADC[6];
-            sei();
-        }
-        v = serialADC2VoltsHCP(v, 4);
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
-        ringBuffer_WriteChar(&serialRB0_TX, '4');
-        ringBuffer_WriteChar(&serialRB0_TX, ':');
-        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, v);
-        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
-        serialModeTX0();
-    } else if(strCompare("psugeta1", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        uint16_t a;
-        {
-            cli();
-            a = currentADC[1];
-            sei();
-        }
-        a = serialADC2TenthMicroampsHCP(a, 1);
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
-        ringBuffer_WriteChar(&serialRB0_TX, '1');
-        ringBuffer_WriteChar(&serialRB0_TX, ':');
-        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, a);
-        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
+    ringBuffer_discardN(&serialRB0_RX, 3); /* Skip sync pattern */
+    dwLen = dwLength - 3;
+    //@ assert dwLen > 2;
+
+    /* Remove end of line for next parser ... */
+    dwLen = dwLen - 1; /* Remove LF */
+    //@ assert dwLen > 0;
+    dwLen = dwLen - ((ringBuffer_PeekCharN(&serialRB0_RX, dwLen-1) == 0x0D) ? 1 : 0); /* Remove CR if present */
+    //@ assert dwLen >= 0;
+
+    /* Now copy message into a local buffer to make parsing WAY easier ... */
+    ringBuffer_ReadChars(&serialRB0_RX, handleSerial0Messages_StringBuffer, dwLen);
+
+    /*
+        Now process that message at <handleSerial0Messages_StringBuffer, dwLen>
+    */
+
+    /*
+        Parse different commands
+    */
+    if(strCompare("id", 2, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        /* Send ID response ... */
+        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__ID, sizeof(handleSerial0Messages_Response__ID)-1);
         serialModeTX0();
-    } else if(strCompare("psugeta2", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        uint16_t a;
-        {
-            cli();
-            a = currentADC[3];
-            sei();
-        }
-        a = serialADC2TenthMicroampsHCP(a, 2);
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
-        ringBuffer_WriteChar(&serialRB0_TX, '2');
-        ringBuffer_WriteChar(&serialRB0_TX, ':');
-        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, a);
-        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
+        filamentCurrent_GetId();
+        filamentCurrent_GetVersion();
+    } else if(strComparePrefix("psugetv", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUGet(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[7]), dwLen-7, true);
         serialModeTX0();
-    } else if(strCompare("psugeta3", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        uint16_t a;
-        {
-            cli();
-            a = currentADC[5];
-            sei();
-        }
-        a = serialADC2TenthMicroampsHCP(a, 3);
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
-        ringBuffer_WriteChar(&serialRB0_TX, '3');
-        ringBuffer_WriteChar(&serialRB0_TX, ':');
-        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, a);
-        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
+    } else if(strComparePrefix("psugeta", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUGet(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[7]), dwLen-7, false);
         serialModeTX0();
-    } else if(strCompare("psugeta4", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        uint16_t a;
-        {
-            cli();
-            a = currentADC[7];
-            sei();
-        }
-        a = serialADC2TenthMicroampsHCP(a, 4);
-        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
-        ringBuffer_WriteChar(&serialRB0_TX, '4');
-        ringBuffer_WriteChar(&serialRB0_TX, ':');
-        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, a);
-        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
+    } else if(strComparePrefix("psupol", 6, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUPolarity(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[6]), dwLen-6);
         serialModeTX0();
-    } else if(strCompare("psupol1p", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        psuStates[0].polPolarity = psuPolarity_Positive;
-        rampMode.mode = controllerRampMode__None;
-    } else if(strCompare("psupol1n", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        psuStates[0].polPolarity = psuPolarity_Negative;
-        rampMode.mode = controllerRampMode__None;
-    } else if(strCompare("psupol2p", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        psuStates[1].polPolarity = psuPolarity_Positive;
-        rampMode.mode = controllerRampMode__None;
-    } else if(strCompare("psupol2n", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        psuStates[1].polPolarity = psuPolarity_Negative;
-        rampMode.mode = controllerRampMode__None;
-    } else if(strCompare("psupol3p", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        psuStates[2].polPolarity = psuPolarity_Positive;
-        rampMode.mode = controllerRampMode__None;
-    } else if(strCompare("psupol3n", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        psuStates[2].polPolarity = psuPolarity_Negative;
-        rampMode.mode = controllerRampMode__None;
-    } else if(strCompare("psupol4p", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        psuStates[3].polPolarity = psuPolarity_Positive;
-    } else if(strCompare("psupol4n", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        psuStates[3].polPolarity = psuPolarity_Negative;
     } else if(strCompare("off", 3, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUVolts(0,1);
-        setPSUVolts(0,2);
-        setPSUVolts(0,3);
-        setPSUVolts(0,4);
+        unsigned long int iPSU;
+        controllerPolarityCancel();
+        for(iPSU = 1; iPSU <= PSU_COUNT; iPSU = iPSU + 1) {
+            setPSUVolts(0, iPSU);
+        }
         filamentCurrent_Enable(false);
         rampMode.mode = controllerRampMode__None;
         statusMessageOff();
     } else if(strCompare("blank", 5, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUVolts(cfgOptions.beamOnRampTargets.wehneltCylinderBlank, 2);
-    } else if(strCompare("unblank", 5, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUVolts(cfgOptions.beamOnRampTargets.wehneltCylinder, 2);
+        if(pwmoutBlank(true) != true) {
+            setPSUVolts(cfgOptions.beamOnRampTargets.wehneltCylinderBlank, 2);
+        }
+    } else if(strCompare("unblank", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        if(pwmoutBlank(false) != true) {
+            setPSUVolts(cfgOptions.beamOnRampTargets.wehneltCylinder, 2);
+        }
     } else if(strCompare("filon", 5, handleSerial0Messages_StringBuffer, dwLen) == true) {
         filamentCurrent_Enable(true);
     } else if(strCompare("filoff", 6, handleSerial0Messages_StringBuffer, dwLen) == true) {
@@ -1346,7 +2540,7 @@ static void handleSerial0Messages_CompleteMessage(
     } else if(strCompare("psumode", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
         unsigned long int iPSU;
         ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__PSUSTATE_Part, sizeof(handleSerial0Messages_Response__PSUSTATE_Part)-1);
-        for(iPSU = 0; iPSU < 4; iPSU = iPSU + 1) {
+        for(iPSU = 0; iPSU < PSU_COUNT; iPSU = iPSU + 1) {
             if(psuStates[iPSU].bOutputEnable != true) {
                 ringBuffer_WriteChar(&serialRB0_TX, '-');
             } else if(psuStates[iPSU].limitMode == psuLimit_Current) {
@@ -1357,28 +2551,12 @@ static void handleSerial0Messages_CompleteMessage(
         }
         ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
         serialModeTX0();
-    } else if(strComparePrefix("psusetv1", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUVolts(strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[8]), dwLen-8), 1);
-        rampMode.mode = controllerRampMode__None;
-    } else if(strComparePrefix("psusetv2", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUVolts(strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[8]), dwLen-8), 2);
-        rampMode.mode = controllerRampMode__None;
-    } else if(strComparePrefix("psusetv3", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUVolts(strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[8]), dwLen-8), 3);
-        rampMode.mode = controllerRampMode__None;
-    } else if(strComparePrefix("psusetv4", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUVolts(strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[8]), dwLen-8), 4);
-    } else if(strComparePrefix("psuseta1", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUMicroamps(strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[8]), dwLen-8), 1);
-        rampMode.mode = controllerRampMode__None;
-    } else if(strComparePrefix("psuseta2", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUMicroamps(strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[8]), dwLen-8), 2);
-        rampMode.mode = controllerRampMode__None;
-    } else if(strComparePrefix("psuseta3", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUMicroamps(strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[8]), dwLen-8), 3);
-        rampMode.mode = controllerRampMode__None;
-    } else if(strComparePrefix("psuseta4", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUMicroamps(strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[8]), dwLen-8), 4);
+    } else if(strComparePrefix("psusetv", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUSet(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[7]), dwLen-7, true);
+        serialModeTX0();
+    } else if(strComparePrefix("psuseta", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUSet(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[7]), dwLen-7, false);
+        serialModeTX0();
     } else if(strComparePrefix("fila", 4, handleSerial0Messages_StringBuffer, dwLen) == true) {
         filamentCurrent_GetCurrent();
     } else if(strComparePrefix("setfila", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
@@ -1388,10 +2566,11 @@ static void handleSerial0Messages_CompleteMessage(
     } else if(strCompare("insul", 5, handleSerial0Messages_StringBuffer, dwLen) == true) {
         rampStart_InsulationTest();
     } else if(strCompare("beamhvoff", 9, handleSerial0Messages_StringBuffer, dwLen) == true) {
-        setPSUVolts(0, 1);
-        setPSUVolts(0, 2);
-        setPSUVolts(0, 3);
-        setPSUVolts(0, 4);
+        unsigned long int iPSU;
+        controllerPolarityCancel();
+        for(iPSU = 1; iPSU <= PSU_COUNT; iPSU = iPSU + 1) {
+            setPSUVolts(0, iPSU);
+        }
         rampMode.mode = controllerRampMode__None;
     } else if(strCompare("beamon", 6, handleSerial0Messages_StringBuffer, dwLen) == true) {
         rampStart_BeamOn();
@@ -1428,9 +2607,11 @@ static void handleSerial0Messages_CompleteMessage(
     } else if(strComparePrefix("setvtargetvwblank", 12+5, handleSerial0Messages_StringBuffer, dwLen) == true) {
         uint32_t newV = strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[12+5]), dwLen-12-5);
         cfgOptions.beamOnRampTargets.wehneltCylinderBlank = newV;
+        pwmoutBlankArm(cfgOptions.beamOnRampTargets.wehneltCylinder, cfgOptions.beamOnRampTargets.wehneltCylinderBlank);
     } else if(strComparePrefix("setvtargetvw", 12+5, handleSerial0Messages_StringBuffer, dwLen) == true) {
         uint32_t newV = strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[12]), dwLen-12);
 	cfgOptions.beamOnRampTargets.wehneltCylinder = newV;
+        pwmoutBlankArm(cfgOptions.beamOnRampTargets.wehneltCylinder, cfgOptions.beamOnRampTargets.wehneltCylinderBlank);
     } else if(strComparePrefix("setvtargetvf", 12, handleSerial0Messages_StringBuffer, dwLen) == true) {
         uint32_t newV = strASCIIToDecimal(&(handleSerial0Messages_StringBuffer[12]), dwLen-12);
         cfgOptions.beamOnRampTargets.focus = newV;
@@ -1543,11 +2724,119 @@ static void handleSerial0Messages_CompleteMessage(
         adcCalibrateHVPS_Amps();
     } else if(strCompare("storesettings", 13, handleSerial0Messages_StringBuffer, dwLen) == true) {
         cfgeepromStore();
+    } else if(strComparePrefix("psufilter", 9, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUFilter(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX0();
+    } else if(strComparePrefix("pwmmode", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMMode(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[7]), dwLen-7);
+        serialModeTX0();
+    } else if(strComparePrefix("pwmslope", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMSlope(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[8]), dwLen-8);
+        serialModeTX0();
+    } else if(strComparePrefix("pwmtrim", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMTrim(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[7]), dwLen-7);
+        serialModeTX0();
+    } else if(strComparePrefix("wavepoint", 9, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_WavePoint(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX0();
+    } else if(strComparePrefix("wavestart", 9, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_WaveStart(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX0();
+    } else if(strComparePrefix("wavestop", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_WaveStop(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[8]), dwLen-8);
+        serialModeTX0();
+    } else if(strComparePrefix("wavestatus", 10, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_WaveStatus(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[10]), dwLen-10);
+        serialModeTX0();
+    } else if(strComparePrefix("psustagev", 9, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUStage(&serialRB0_TX, true, &(handleSerial0Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX0();
+    } else if(strComparePrefix("psustagea", 9, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUStage(&serialRB0_TX, false, &(handleSerial0Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX0();
+    } else if(strCompare("psustageclear", 13, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        pwmoutStageDiscard();
+    } else if(strCompare("psustage", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__PSUSTAGE, sizeof(handleSerial0Messages_Response__PSUSTAGE)-1);
+        ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, pwmoutStageGetMask());
+        ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
+        serialModeTX0();
+    } else if(strComparePrefix("psucommitv", 10, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUCommitVolts(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[10]), dwLen-10);
+        serialModeTX0();
+    } else if(strCompare("psucommit", 9, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        pwmoutCommit();
+    } else if(strComparePrefix("pwmscale", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMScale(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[8]), dwLen-8);
+        serialModeTX0();
+    } else if(strComparePrefix("pwmpwl", 6, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMPwl(&serialRB0_TX, &serialReport0, &(handleSerial0Messages_StringBuffer[6]), dwLen-6);
+        serialModeTX0();
+    } else if(strComparePrefix("blanktrig", 9, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_BlankTrigger(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX0();
+    } else if(strComparePrefix("slew", 4, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_Slew(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[4]), dwLen-4);
+        serialModeTX0();
+    } else if(strComparePrefix("pwmprofile", 10, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMProfile(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[10]), dwLen-10);
+        serialModeTX0();
+    #ifdef SYSCLOCK_ISR_STATISTICS
+    } else if(strCompare("pwmbench", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMBench(&serialRB0_TX);
+        serialModeTX0();
+    #endif
+    } else if(strComparePrefix("cclatch", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_CCLatch(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[7]), dwLen-7);
+        serialModeTX0();
+    } else if(strComparePrefix("protection", 10, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_Protection(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[10]), dwLen-10);
+        serialModeTX0();
+    } else if(strCompare("trip", 4, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        struct adcTripStatus trip;
+        adcTripGetStatus(&trip);
+        rampMessage_OvercurrentTrip_Write(&serialRB0_TX, &trip);
+        serialModeTX0();
+    } else if(strCompare("profile", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_Profile(&serialReport0);
+    } else if(strCompare("profilereset", 12, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        controllerProfileReset();
+    #ifdef SYSCLOCK_ISR_STATISTICS
+    } else if(strCompare("isrstats", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ISRStatistics(&serialReport0);
+    #endif
+    } else if(strComparePrefix("adcdecimation", 13, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCDecimation(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[13]), dwLen-13);
+        serialModeTX0();
+    } else if(strComparePrefix("adcscan", 7, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCScan(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[7]), dwLen-7);
+        serialModeTX0();
+    } else if(strComparePrefix("adcget", 6, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCGet(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[6]), dwLen-6);
+        serialModeTX0();
+    } else if(strComparePrefix("adctracearm", 11, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCTraceArm(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[11]), dwLen-11);
+        serialModeTX0();
+    } else if(strComparePrefix("adctracedump", 12, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCTraceDump(&serialRB0_TX, &serialReport0, &(handleSerial0Messages_StringBuffer[12]), dwLen-12);
+        serialModeTX0();
+    } else if(strCompare("adctracetrig", 12, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        adcTraceTrigger(ADC_TRACE_SOURCE_MANUAL);
+    } else if(strCompare("adctracestop", 12, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        adcTraceStop();
+    } else if(strCompare("adctrace", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCTraceStatus(&serialRB0_TX);
+        serialModeTX0();
+    } else if(strComparePrefix("adcstatwindow", 13, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCStatisticsWindow(&serialRB0_TX, &(handleSerial0Messages_StringBuffer[13]), dwLen-13);
+        serialModeTX0();
+    } else if(strCompare("adcstats", 8, handleSerial0Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCStatistics(&serialReport0);
 #ifdef DEBUG
     } else if(strCompare("rawadc", 6, handleSerial0Messages_StringBuffer, dwLen) == true) {
         /* Deliver raw adc value of frist channel for testing purpose ... */
         char bTemp[6];
-        uint16_t adcValue = currentADC[0];
+        uint16_t adcValue = psuStates[0].realV;
 
         int len = 0;
         unsigned long int i;
@@ -1596,6 +2885,11 @@ void handleSerial0Messages() {
     unsigned long int dwAvailableLength;
     unsigned long int dwMessageEnd;
 
+    /* Continue any pending multi line report */
+    if(serialReport_Pump(&serialReport0, &serialRB0_TX) == true) {
+        serialModeTX0();
+    }
+
     /*
         We simply check if a full message has arrived in the ringbuffer. If
         it has we will start to decode the message with the appropriate module
@@ -1717,152 +3011,32 @@ void handleSerial0Messages() {
             serialModeTX1();
             filamentCurrent_GetId();
             filamentCurrent_GetVersion();
-        } else if(strCompare("psugetv1", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            uint16_t v;
-            {
-                cli();
-                v = currentADC[0];
-                sei();
-            }
-            v = serialADC2VoltsHCP(v, 1);
-            ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
-            ringBuffer_WriteChar(&serialRB1_TX, '1');
-            ringBuffer_WriteChar(&serialRB1_TX, ':');
-            ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, v);
-            ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
-            serialModeTX1();
-        } else if(strCompare("psugetv2", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            uint16_t v;
-            {
-                cli();
-                v = currentADC[2];
-                sei();
-            }
-            v = serialADC2VoltsHCP(v, 2);
-            ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
-            ringBuffer_WriteChar(&serialRB1_TX, '2');
-            ringBuffer_WriteChar(&serialRB1_TX, ':');
-            ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, v);
-            ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
-            serialModeTX1();
-        } else if(strCompare("psugetv3", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            uint16_t v;
-            {
-                cli();
-                v = currentADC[4];
-                sei();
-            }
-            v = serialADC2VoltsHCP(v, 3);
-            ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
-            ringBuffer_WriteChar(&serialRB1_TX, '3');
-            ringBuffer_WriteChar(&serialRB1_TX, ':');
-            ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, v);
-            ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
-            serialModeTX1();
-        } else if(strCompare("psugetv4", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            uint16_t v;
-            {
-                cli();
-                v = currentADC[6];
-                sei();
-            }
-            v = serialADC2VoltsHCP(v, 4);
-            ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
-            ringBuffer_WriteChar(&serialRB1_TX, '4');
-            ringBuffer_WriteChar(&serialRB1_TX, ':');
-            ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, v);
-            ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
-            serialModeTX1();
-        } else if(strCompare("psugeta1", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            uint16_t a;
-            {
-                cli();
-                a = currentADC[1];
-                sei();
-            }
-            a = serialADC2TenthMicroampsHCP(a, 1);
-            ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
-            ringBuffer_WriteChar(&serialRB1_TX, '1');
-            ringBuffer_WriteChar(&serialRB1_TX, ':');
-            ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, a);
-            ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
-            serialModeTX1();
-        } else if(strCompare("psugeta2", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            uint16_t a;
-            {
-                cli();
-                a = currentADC[3];
-                sei();
-            }
-            a = serialADC2TenthMicroampsHCP(a, 2);
-            ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
-            ringBuffer_WriteChar(&serialRB1_TX, '2');
-            ringBuffer_WriteChar(&serialRB1_TX, ':');
-            ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, a);
-            ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
+        } else if(strComparePrefix("psugetv", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+            serialCommand_PSUGet(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[7]), dwLen-7, true);
             serialModeTX1();
-        } else if(strCompare("psugeta3", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            uint16_t a;
-            {
-                cli();
-                a = currentADC[5];
-                sei();
-            }
-            a = serialADC2TenthMicroampsHCP(a, 3);
-            ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
-            ringBuffer_WriteChar(&serialRB1_TX, '3');
-            ringBuffer_WriteChar(&serialRB1_TX, ':');
-            ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, a);
-            ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
+        } else if(strComparePrefix("psugeta", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+            serialCommand_PSUGet(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[7]), dwLen-7, false);
             serialModeTX1();
-        } else if(strCompare("psugeta4", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            uint16_t a;
-            {
-                cli();
-                a = currentADC[7];
-                sei();
-            }
-            a = serialADC2TenthMicroampsHCP(a, 4);
-            ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__AN_Part, sizeof(handleSerial0Messages_Response__AN_Part)-1);
-            ringBuffer_WriteChar(&serialRB1_TX, '4');
-            ringBuffer_WriteChar(&serialRB1_TX, ':');
-            ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, a);
-            ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
+        } else if(strComparePrefix("psupol", 6, handleSerial1Messages_StringBuffer, dwLen) == true) {
+            serialCommand_PSUPolarity(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[6]), dwLen-6);
             serialModeTX1();
-        } else if(strCompare("psupol1p", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            psuStates[0].polPolarity = psuPolarity_Positive;
-            rampMode.mode = controllerRampMode__None;
-        } else if(strCompare("psupol1n", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            psuStates[0].polPolarity = psuPolarity_Negative;
-            rampMode.mode = controllerRampMode__None;
-        } else if(strCompare("psupol2p", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            psuStates[1].polPolarity = psuPolarity_Positive;
-            rampMode.mode = controllerRampMode__None;
-        } else if(strCompare("psupol2n", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            psuStates[1].polPolarity = psuPolarity_Negative;
-            rampMode.mode = controllerRampMode__None;
-        } else if(strCompare("psupol3p", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            psuStates[2].polPolarity = psuPolarity_Positive;
-            rampMode.mode = controllerRampMode__None;
-        } else if(strCompare("psupol3n", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            psuStates[2].polPolarity = psuPolarity_Negative;
-            rampMode.mode = controllerRampMode__None;
-        } else if(strCompare("psupol4p", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            psuStates[3].polPolarity = psuPolarity_Positive;
-        } else if(strCompare("psupol4n", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            psuStates[3].polPolarity = psuPolarity_Negative;
         } else if(strCompare("off", 3, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUVolts(0, 1);
-            setPSUVolts(0, 2);
-            setPSUVolts(0, 3);
-            setPSUVolts(0, 4);
+            unsigned long int iPSU;
+            controllerPolarityCancel();
+            for(iPSU = 1; iPSU <= PSU_COUNT; iPSU = iPSU + 1) {
+                setPSUVolts(0, iPSU);
+            }
             filamentCurrent_Enable(false);
             rampMode.mode = controllerRampMode__None;
             statusMessageOff();
         } else if(strCompare("blank", 5, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUVolts(cfgOptions.beamOnRampTargets.wehneltCylinderBlank, 2);
-        } else if(strCompare("unblank", 5, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUVolts(cfgOptions.beamOnRampTargets.wehneltCylinder, 2);
+            if(pwmoutBlank(true) != true) {
+                setPSUVolts(cfgOptions.beamOnRampTargets.wehneltCylinderBlank, 2);
+            }
+        } else if(strCompare("unblank", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+            if(pwmoutBlank(false) != true) {
+                setPSUVolts(cfgOptions.beamOnRampTargets.wehneltCylinder, 2);
+            }
         } else if(strCompare("filon", 5, handleSerial1Messages_StringBuffer, dwLen) == true) {
             filamentCurrent_Enable(true);
         } else if(strCompare("filoff", 6, handleSerial1Messages_StringBuffer, dwLen) == true) {
@@ -1871,7 +3045,7 @@ void handleSerial0Messages() {
         } else if(strCompare("psumode", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
             unsigned long int iPSU;
             ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__PSUSTATE_Part, sizeof(handleSerial0Messages_Response__PSUSTATE_Part)-1);
-            for(iPSU = 0; iPSU < 4; iPSU = iPSU + 1) {
+            for(iPSU = 0; iPSU < PSU_COUNT; iPSU = iPSU + 1) {
                 if(psuStates[iPSU].bOutputEnable != true) {
                     ringBuffer_WriteChar(&serialRB1_TX, '-');
                 } else if(psuStates[iPSU].limitMode == psuLimit_Current) {
@@ -1882,28 +3056,12 @@ void handleSerial0Messages() {
             }
             ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
             serialModeTX1();
-        } else if(strComparePrefix("psusetv1", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUVolts(strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[8]), dwLen-8), 1);
-            rampMode.mode = controllerRampMode__None;
-        } else if(strComparePrefix("psusetv2", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUVolts(strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[8]), dwLen-8), 2);
-            rampMode.mode = controllerRampMode__None;
-        } else if(strComparePrefix("psusetv3", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUVolts(strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[8]), dwLen-8), 3);
-            rampMode.mode = controllerRampMode__None;
-        } else if(strComparePrefix("psusetv4", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUVolts(strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[8]), dwLen-8), 4);
-        } else if(strComparePrefix("psuseta1", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUMicroamps(strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[8]), dwLen-8), 1);
-            rampMode.mode = controllerRampMode__None;
-        } else if(strComparePrefix("psuseta2", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUMicroamps(strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[8]), dwLen-8), 2);
-            rampMode.mode = controllerRampMode__None;
-        } else if(strComparePrefix("psuseta3", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUMicroamps(strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[8]), dwLen-8), 3);
-            rampMode.mode = controllerRampMode__None;
-        } else if(strComparePrefix("psuseta4", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUMicroamps(strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[8]), dwLen-8), 4);
+        } else if(strComparePrefix("psusetv", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+            serialCommand_PSUSet(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[7]), dwLen-7, true);
+            serialModeTX1();
+        } else if(strComparePrefix("psuseta", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+            serialCommand_PSUSet(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[7]), dwLen-7, false);
+            serialModeTX1();
         } else if(strComparePrefix("fila", 4, handleSerial1Messages_StringBuffer, dwLen) == true) {
             filamentCurrent_GetCurrent();
         } else if(strComparePrefix("setfila", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
@@ -1913,10 +3071,11 @@ void handleSerial0Messages() {
         } else if(strCompare("insul", 5, handleSerial1Messages_StringBuffer, dwLen) == true) {
             rampStart_InsulationTest();
         } else if(strCompare("beamhvoff", 9, handleSerial1Messages_StringBuffer, dwLen) == true) {
-            setPSUVolts(0, 1);
-            setPSUVolts(0, 2);
-            setPSUVolts(0, 3);
-            setPSUVolts(0, 4);
+            unsigned long int iPSU;
+            controllerPolarityCancel();
+            for(iPSU = 1; iPSU <= PSU_COUNT; iPSU = iPSU + 1) {
+                setPSUVolts(0, iPSU);
+            }
             rampMode.mode = controllerRampMode__None;
         } else if(strCompare("beamon", 6, handleSerial1Messages_StringBuffer, dwLen) == true) {
             rampStart_BeamOn();
@@ -1953,9 +3112,11 @@ void handleSerial0Messages() {
     } else if(strComparePrefix("setvtargetvwblank", 12+5, handleSerial1Messages_StringBuffer, dwLen) == true) {
         uint32_t newV = strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[12+5]), dwLen-12-5);
         cfgOptions.beamOnRampTargets.wehneltCylinderBlank = newV;
+        pwmoutBlankArm(cfgOptions.beamOnRampTargets.wehneltCylinder, cfgOptions.beamOnRampTargets.wehneltCylinderBlank);
     } else if(strComparePrefix("setvtargetvw", 12, handleSerial1Messages_StringBuffer, dwLen) == true) {
         uint32_t newV = strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[12]), dwLen-12);
 	cfgOptions.beamOnRampTargets.wehneltCylinder = newV;
+        pwmoutBlankArm(cfgOptions.beamOnRampTargets.wehneltCylinder, cfgOptions.beamOnRampTargets.wehneltCylinderBlank);
     } else if(strComparePrefix("setvtargetvf", 12, handleSerial1Messages_StringBuffer, dwLen) == true) {
         uint32_t newV = strASCIIToDecimal(&(handleSerial1Messages_StringBuffer[12]), dwLen-12);
         cfgOptions.beamOnRampTargets.focus = newV;
@@ -2059,6 +3220,114 @@ void handleSerial0Messages() {
         serialModeTX1();
     } else if(strCompare("storesettings", 13, handleSerial1Messages_StringBuffer, dwLen) == true) {
         cfgeepromStore();
+    } else if(strComparePrefix("psufilter", 9, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUFilter(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX1();
+    } else if(strComparePrefix("pwmmode", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMMode(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[7]), dwLen-7);
+        serialModeTX1();
+    } else if(strComparePrefix("pwmslope", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMSlope(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[8]), dwLen-8);
+        serialModeTX1();
+    } else if(strComparePrefix("pwmtrim", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMTrim(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[7]), dwLen-7);
+        serialModeTX1();
+    } else if(strComparePrefix("wavepoint", 9, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_WavePoint(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX1();
+    } else if(strComparePrefix("wavestart", 9, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_WaveStart(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX1();
+    } else if(strComparePrefix("wavestop", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_WaveStop(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[8]), dwLen-8);
+        serialModeTX1();
+    } else if(strComparePrefix("wavestatus", 10, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_WaveStatus(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[10]), dwLen-10);
+        serialModeTX1();
+    } else if(strComparePrefix("psustagev", 9, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUStage(&serialRB1_TX, true, &(handleSerial1Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX1();
+    } else if(strComparePrefix("psustagea", 9, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUStage(&serialRB1_TX, false, &(handleSerial1Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX1();
+    } else if(strCompare("psustageclear", 13, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        pwmoutStageDiscard();
+    } else if(strCompare("psustage", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        ringBuffer_WriteChars(&serialRB1_TX, handleSerial0Messages_Response__PSUSTAGE, sizeof(handleSerial0Messages_Response__PSUSTAGE)-1);
+        ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, pwmoutStageGetMask());
+        ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
+        serialModeTX1();
+    } else if(strComparePrefix("psucommitv", 10, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PSUCommitVolts(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[10]), dwLen-10);
+        serialModeTX1();
+    } else if(strCompare("psucommit", 9, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        pwmoutCommit();
+    } else if(strComparePrefix("pwmscale", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMScale(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[8]), dwLen-8);
+        serialModeTX1();
+    } else if(strComparePrefix("pwmpwl", 6, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMPwl(&serialRB1_TX, &serialReport1, &(handleSerial1Messages_StringBuffer[6]), dwLen-6);
+        serialModeTX1();
+    } else if(strComparePrefix("blanktrig", 9, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_BlankTrigger(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[9]), dwLen-9);
+        serialModeTX1();
+    } else if(strComparePrefix("slew", 4, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_Slew(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[4]), dwLen-4);
+        serialModeTX1();
+    } else if(strComparePrefix("pwmprofile", 10, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMProfile(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[10]), dwLen-10);
+        serialModeTX1();
+    #ifdef SYSCLOCK_ISR_STATISTICS
+    } else if(strCompare("pwmbench", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_PWMBench(&serialRB1_TX);
+        serialModeTX1();
+    #endif
+    } else if(strComparePrefix("cclatch", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_CCLatch(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[7]), dwLen-7);
+        serialModeTX1();
+    } else if(strComparePrefix("protection", 10, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_Protection(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[10]), dwLen-10);
+        serialModeTX1();
+    } else if(strCompare("trip", 4, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        struct adcTripStatus trip;
+        adcTripGetStatus(&trip);
+        rampMessage_OvercurrentTrip_Write(&serialRB1_TX, &trip);
+        serialModeTX1();
+    } else if(strCompare("profile", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_Profile(&serialReport1);
+    } else if(strCompare("profilereset", 12, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        controllerProfileReset();
+    #ifdef SYSCLOCK_ISR_STATISTICS
+    } else if(strCompare("isrstats", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ISRStatistics(&serialReport1);
+    #endif
+    } else if(strComparePrefix("adcdecimation", 13, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCDecimation(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[13]), dwLen-13);
+        serialModeTX1();
+    } else if(strComparePrefix("adcscan", 7, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCScan(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[7]), dwLen-7);
+        serialModeTX1();
+    } else if(strComparePrefix("adcget", 6, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCGet(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[6]), dwLen-6);
+        serialModeTX1();
+    } else if(strComparePrefix("adctracearm", 11, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCTraceArm(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[11]), dwLen-11);
+        serialModeTX1();
+    } else if(strComparePrefix("adctracedump", 12, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCTraceDump(&serialRB1_TX, &serialReport1, &(handleSerial1Messages_StringBuffer[12]), dwLen-12);
+        serialModeTX1();
+    } else if(strCompare("adctracetrig", 12, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        adcTraceTrigger(ADC_TRACE_SOURCE_MANUAL);
+    } else if(strCompare("adctracestop", 12, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        adcTraceStop();
+    } else if(strCompare("adctrace", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCTraceStatus(&serialRB1_TX);
+        serialModeTX1();
+    } else if(strComparePrefix("adcstatwindow", 13, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCStatisticsWindow(&serialRB1_TX, &(handleSerial1Messages_StringBuffer[13]), dwLen-13);
+        serialModeTX1();
+    } else if(strCompare("adcstats", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
+        serialCommand_ADCStatistics(&serialReport1);
     } else if(strCompare("calhvpsu", 8, handleSerial1Messages_StringBuffer, dwLen) == true) {
         /* Calibrate so ADC value relfects current set value for all 4 PSUs */
         adcCalibrateHVPS_Volts();
@@ -2068,7 +3337,7 @@ void handleSerial0Messages() {
         } else if(strCompare("rawadc", 6, handleSerial1Messages_StringBuffer, dwLen) == true) {
             /* Deliver raw adc value of frist channel for testing purpose ... */
             char bTemp[6];
-            uint16_t adcValue = currentADC[0];
+            uint16_t adcValue = psuStates[0].realV;
 
             int len = 0;
             unsigned long int i;
@@ -2106,6 +3375,11 @@ void handleSerial0Messages() {
         unsigned long int dwAvailableLength;
         unsigned long int dwMessageEnd;
 
+        /* Continue any pending multi line report */
+        if(serialReport_Pump(&serialReport1, &serialRB1_TX) == true) {
+            serialModeTX1();
+        }
+
         /*
             We simply check if a full message has arrived in the ringbuffer. If
             it has we will start to decode the message with the appropriate module
@@ -2360,18 +3634,12 @@ void handleSerial2Messages() {
 void rampMessage_ReportVoltages() {
     unsigned long int i;
     /*@
-        loop invariant 0 <= i <= 4;
+        loop invariant 0 <= i <= PSU_COUNT;
         loop assigns serialRB0_TX.buffer[0 .. SERIAL_RINGBUFFER_SIZE];
-        loop variant 4 - i;
+        loop variant PSU_COUNT - i;
     */
-    for(i = 0; i < 4; i=i+1) {
-        uint16_t v;
-        {
-            cli();
-            v = currentADC[i*2];
-            sei();
-        }
-        v = serialADC2VoltsHCP(v, i+1);
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        uint16_t v = serialADC2VoltsHCP(psuStates[i].realV, i+1);
 
         ringBuffer_WriteChars(&serialRB0_TX, handleSerial0Messages_Response__VN_Part, sizeof(handleSerial0Messages_Response__VN_Part)-1);
         ringBuffer_WriteChar(&serialRB0_TX, 0x31+i);
@@ -2455,7 +3723,7 @@ static unsigned char rampMessage_InsulationTestFailure__Message[] = "$$$insulfai
 void rampMessage_InsulationTestFailure() {
     unsigned long int i;
     ringBuffer_WriteChars(&serialRB0_TX, rampMessage_InsulationTestFailure__Message, sizeof(rampMessage_InsulationTestFailure__Message)-1);
-    for(i = 0; i < 4; i=i+1) {
+    for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
         ringBuffer_WriteChar(&serialRB0_TX, ((rampMode.vTargets[i] != 0) && (psuStates[i].limitMode == psuLimit_Current)) ? 'F' : '-');
     }
     ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
@@ -2463,7 +3731,7 @@ void rampMessage_InsulationTestFailure() {
 
     #ifdef SERIAL_UART1_ENABLE
         ringBuffer_WriteChars(&serialRB1_TX, rampMessage_InsulationTestFailure__Message, sizeof(rampMessage_InsulationTestFailure__Message)-1);
-        for(i = 0; i < 4; i=i+1) {
+        for(i = 0; i < CONTROLLER_RAMP_PSUS; i=i+1) {
             ringBuffer_WriteChar(&serialRB1_TX, ((rampMode.vTargets[i] != 0) && (psuStates[i].limitMode == psuLimit_Current)) ? 'F' : '-');
         }
         ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
@@ -2471,6 +3739,125 @@ void rampMessage_InsulationTestFailure() {
     #endif
 }
 
+static unsigned char rampMessage_OvercurrentTrip__Message[] = "$$$trip:";
+static void rampMessage_OvercurrentTrip_Write(
+    volatile struct ringBuffer* lpTX,
+    struct adcTripStatus* lpTrip
+) {
+    ringBuffer_WriteChars(lpTX, rampMessage_OvercurrentTrip__Message, sizeof(rampMessage_OvercurrentTrip__Message)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, lpTrip->tripCount);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, lpTrip->channel);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, lpTrip->raw);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, lpTrip->responseMicros);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, lpTrip->maxResponseMicros);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, adcGetScanPeriodMicros());
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+void rampMessage_OvercurrentTrip(struct adcTripStatus* lpTrip) {
+    rampMessage_OvercurrentTrip_Write(&serialRB0_TX, lpTrip);
+    serialModeTX0();
+
+    #ifdef SERIAL_UART1_ENABLE
+        rampMessage_OvercurrentTrip_Write(&serialRB1_TX, lpTrip);
+        serialModeTX1();
+    #endif
+}
+
+static unsigned char rampMessage_LimitEvent__Message[] = "$$$ccevent:";
+static void rampMessage_LimitEvent_Write(
+    volatile struct ringBuffer* lpTX,
+    uint8_t psuMask
+) {
+    struct psuLimitLatch latch;
+    uint8_t i;
+
+    ringBuffer_WriteChars(lpTX, rampMessage_LimitEvent__Message, sizeof(rampMessage_LimitEvent__Message)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, psuMask);
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        psuLimitGetLatch(i, &latch);
+        ringBuffer_WriteChar(lpTX, ':');
+        ringBuffer_WriteASCIIUnsignedInt(lpTX, latch.count);
+    }
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+void rampMessage_LimitEvent(uint8_t psuMask) {
+    rampMessage_LimitEvent_Write(&serialRB0_TX, psuMask);
+    serialModeTX0();
+
+    #ifdef SERIAL_UART1_ENABLE
+        rampMessage_LimitEvent_Write(&serialRB1_TX, psuMask);
+        serialModeTX1();
+    #endif
+}
+
+static unsigned char rampMessage_ProtectionTrip__Message[] = "$$$protrip:";
+static void rampMessage_ProtectionTrip_Write(
+    volatile struct ringBuffer* lpTX,
+    uint8_t psuIndex,
+    uint8_t rule
+) {
+    ringBuffer_WriteChars(lpTX, rampMessage_ProtectionTrip__Message, sizeof(rampMessage_ProtectionTrip__Message)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, psuIndex + 1);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, rule);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+void rampMessage_ProtectionTrip(uint8_t psuIndex, uint8_t rule) {
+    rampMessage_ProtectionTrip_Write(&serialRB0_TX, psuIndex, rule);
+    serialModeTX0();
+
+    #ifdef SERIAL_UART1_ENABLE
+        rampMessage_ProtectionTrip_Write(&serialRB1_TX, psuIndex, rule);
+        serialModeTX1();
+    #endif
+}
+
+static unsigned char rampMessage_PolarityDone__Message[] = "$$$poldone:";
+static void rampMessage_PolarityDone_Write(
+    volatile struct ringBuffer* lpTX,
+    uint8_t psuIndex,
+    uint8_t result
+) {
+    ringBuffer_WriteChars(lpTX, rampMessage_PolarityDone__Message, sizeof(rampMessage_PolarityDone__Message)-1);
+    ringBuffer_WriteASCIIUnsignedInt(lpTX, psuIndex + 1);
+    ringBuffer_WriteChar(lpTX, ':');
+    ringBuffer_WriteChar(lpTX, result);
+    ringBuffer_WriteChar(lpTX, 0x0A);
+}
+
+void rampMessage_PolarityDone(uint8_t psuIndex, uint8_t result) {
+    rampMessage_PolarityDone_Write(&serialRB0_TX, psuIndex, result);
+    serialModeTX0();
+
+    #ifdef SERIAL_UART1_ENABLE
+        rampMessage_PolarityDone_Write(&serialRB1_TX, psuIndex, result);
+        serialModeTX1();
+    #endif
+}
+
+static unsigned char rampMessage_SlewDone__Message[] = "$$$slewdone:";
+void rampMessage_SlewDone(uint16_t channelMask) {
+    ringBuffer_WriteChars(&serialRB0_TX, rampMessage_SlewDone__Message, sizeof(rampMessage_SlewDone__Message)-1);
+    ringBuffer_WriteASCIIUnsignedInt(&serialRB0_TX, channelMask);
+    ringBuffer_WriteChar(&serialRB0_TX, 0x0A);
+    serialModeTX0();
+
+    #ifdef SERIAL_UART1_ENABLE
+        ringBuffer_WriteChars(&serialRB1_TX, rampMessage_SlewDone__Message, sizeof(rampMessage_SlewDone__Message)-1);
+        ringBuffer_WriteASCIIUnsignedInt(&serialRB1_TX, channelMask);
+        ringBuffer_WriteChar(&serialRB1_TX, 0x0A);
+        serialModeTX1();
+    #endif
+}
+
 static unsigned char statusMessageOff_Msg[] = "$$$off\n";
 void statusMessageOff() {
 
@@ -2566,57 +3953,54 @@ void filamentCurrent_EnableProtection(bool bEnabled) {
 
 static void adcCalibrateHVPS_Volts() {
     unsigned long int i;
+    uint8_t channel;
+    double adcScale = (double)(1 << (ADC_OVERSAMPLED_BITS - 10));
 
     /* Perform two-point calibration for voltage of ADCs */
-    if(psuStates[0].setVTarget == 0) {
-        /* Low point just records ADC values */
-        cfgOptions.psuADCCalibration.channel[0].adc0 = currentADC[0];
-        cfgOptions.psuADCCalibration.channel[2].adc0 = currentADC[2];
-        cfgOptions.psuADCCalibration.channel[4].adc0 = currentADC[4];
-        cfgOptions.psuADCCalibration.channel[6].adc0 = currentADC[6];
-    } else {
-        /* High point */
-        cfgOptions.psuADCCalibration.channel[0].adc1 = currentADC[0];
-        cfgOptions.psuADCCalibration.channel[0].vhigh = psuStates[0].setVTarget;
-        cfgOptions.psuADCCalibration.channel[2].adc1 = currentADC[2];
-        cfgOptions.psuADCCalibration.channel[2].vhigh = psuStates[1].setVTarget;
-        cfgOptions.psuADCCalibration.channel[4].adc1 = currentADC[4];
-        cfgOptions.psuADCCalibration.channel[4].vhigh = psuStates[2].setVTarget;
-        cfgOptions.psuADCCalibration.channel[6].adc1 = currentADC[6];
-        cfgOptions.psuADCCalibration.channel[6].vhigh = psuStates[3].setVTarget;
-
-        /* Perform calculations */
-        for(i = 0; i < 4; i=i+1) {
-            cfgOptions.psuADCCalibration.channel[i << 1].k = (uint16_t)((double)(cfgOptions.psuADCCalibration.channel[i << 1].vhigh) / ((double)(cfgOptions.psuADCCalibration.channel[i << 1].adc1) - (double)(cfgOptions.psuADCCalibration.channel[i << 1].adc0)));
-            cfgOptions.psuADCCalibration.channel[i << 1].d = (uint16_t)((double)(cfgOptions.psuADCCalibration.channel[i << 1].vhigh) / ((double)(cfgOptions.psuADCCalibration.channel[i << 1].adc1) - (double)(cfgOptions.psuADCCalibration.channel[i << 1].adc0)) * (double)(cfgOptions.psuADCCalibration.channel[i << 1].adc0));
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        channel = (i << 1);
+        if(psuStates[0].setVTarget == 0) {
+            /* Low point just records ADC values */
+            cfgOptions.psuADCCalibration.channel[channel].adc0 = psuStates[i].realV;
+        } else {
+            /* High point */
+            cfgOptions.psuADCCalibration.channel[channel].adc1 = psuStates[i].realV;
+            cfgOptions.psuADCCalibration.channel[channel].vhigh = psuStates[i].setVTarget;
+
+            /* Perform calculations */
+            /* Readings are ADC_OVERSAMPLED_BITS wide, the model is kept per 10 bit count */
+            cfgOptions.psuADCCalibration.channel[channel].k = (uint16_t)((double)(cfgOptions.psuADCCalibration.channel[channel].vhigh) / (((double)(cfgOptions.psuADCCalibration.channel[channel].adc1) - (double)(cfgOptions.psuADCCalibration.channel[channel].adc0)) / adcScale));
+            cfgOptions.psuADCCalibration.channel[channel].d = (uint16_t)((double)(cfgOptions.psuADCCalibration.channel[channel].vhigh) / (((double)(cfgOptions.psuADCCalibration.channel[channel].adc1) - (double)(cfgOptions.psuADCCalibration.channel[channel].adc0)) / adcScale) * ((double)(cfgOptions.psuADCCalibration.channel[channel].adc0) / adcScale));
         }
     }
+    if(psuStates[0].setVTarget != 0) {
+        adcCalibrationUpdate();
+    }
 }
 
 static void adcCalibrateHVPS_Amps() {
     unsigned long int i;
-    /* Perform two-point calibration for voltage of ADCs */
-    if(psuStates[0].setVTarget == 0) {
-        /* Low point just records ADC values */
-        cfgOptions.psuADCCalibration.channel[1].adc0 = currentADC[0];
-        cfgOptions.psuADCCalibration.channel[3].adc0 = currentADC[2];
-        cfgOptions.psuADCCalibration.channel[5].adc0 = currentADC[4];
-        cfgOptions.psuADCCalibration.channel[7].adc0 = currentADC[6];
-    } else {
-        /* High point */
-        cfgOptions.psuADCCalibration.channel[1].adc1 = currentADC[0];
-        cfgOptions.psuADCCalibration.channel[1].vhigh = psuStates[0].setILimit;
-        cfgOptions.psuADCCalibration.channel[3].adc1 = currentADC[2];
-        cfgOptions.psuADCCalibration.channel[3].vhigh = psuStates[1].setILimit;
-        cfgOptions.psuADCCalibration.channel[5].adc1 = currentADC[4];
-        cfgOptions.psuADCCalibration.channel[5].vhigh = psuStates[2].setILimit;
-        cfgOptions.psuADCCalibration.channel[7].adc1 = currentADC[6];
-        cfgOptions.psuADCCalibration.channel[7].vhigh = psuStates[3].setILimit;
-
-        /* Perform calculations */
-        for(i = 0; i < 4; i=i+1) {
-            cfgOptions.psuADCCalibration.channel[(i << 1) + 1].k = (uint16_t)((double)(cfgOptions.psuADCCalibration.channel[(i << 1) + 1].vhigh) / ((double)(cfgOptions.psuADCCalibration.channel[(i << 1) + 1].adc1) - (double)(cfgOptions.psuADCCalibration.channel[(i << 1) + 1].adc0)));
-            cfgOptions.psuADCCalibration.channel[(i << 1) + 1].d = (uint16_t)((double)(cfgOptions.psuADCCalibration.channel[(i << 1) + 1].vhigh) / ((double)(cfgOptions.psuADCCalibration.channel[(i << 1) + 1].adc1) - (double)(cfgOptions.psuADCCalibration.channel[(i << 1) + 1].adc0)) * (double)(cfgOptions.psuADCCalibration.channel[(i << 1) + 1].adc0));
+    uint8_t channel;
+    double adcScale = (double)(1 << (ADC_OVERSAMPLED_BITS - 10));
+
+    /* Perform two-point calibration for current of ADCs */
+    for(i = 0; i < PSU_COUNT; i=i+1) {
+        channel = (i << 1) + 1;
+        if(psuStates[0].setVTarget == 0) {
+            /* Low point just records ADC values */
+            cfgOptions.psuADCCalibration.channel[channel].adc0 = psuStates[i].realI;
+        } else {
+            /* High point */
+            cfgOptions.psuADCCalibration.channel[channel].adc1 = psuStates[i].realI;
+            cfgOptions.psuADCCalibration.channel[channel].vhigh = psuStates[i].setILimit;
+
+            /* Perform calculations */
+            /* Readings are ADC_OVERSAMPLED_BITS wide, the model is kept per 10 bit count */
+            cfgOptions.psuADCCalibration.channel[channel].k = (uint16_t)((double)(cfgOptions.psuADCCalibration.channel[channel].vhigh) / (((double)(cfgOptions.psuADCCalibration.channel[channel].adc1) - (double)(cfgOptions.psuADCCalibration.channel[channel].adc0)) / adcScale));
+            cfgOptions.psuADCCalibration.channel[channel].d = (uint16_t)((double)(cfgOptions.psuADCCalibration.channel[channel].vhigh) / (((double)(cfgOptions.psuADCCalibration.channel[channel].adc1) - (double)(cfgOptions.psuADCCalibration.channel[channel].adc0)) / adcScale) * ((double)(cfgOptions.psuADCCalibration.channel[channel].adc0) / adcScale));
         }
     }
+    if(psuStates[0].setVTarget != 0) {
+        adcCalibrationUpdate();
+    }
 }
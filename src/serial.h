@@ -28,11 +28,18 @@ void handleSerial0Messages();
 void handleSerial1Messages();
 void handleSerial2Messages();
 
+struct adcTripStatus;
+
 void rampMessage_ReportVoltages();
 void rampMessage_ReportFilaCurrents();
 
 void rampMessage_InsulationTestSuccess();
 void rampMessage_InsulationTestFailure();
+void rampMessage_OvercurrentTrip(struct adcTripStatus* lpTrip);
+void rampMessage_SlewDone(uint16_t channelMask);
+void rampMessage_LimitEvent(uint8_t psuMask);
+void rampMessage_ProtectionTrip(uint8_t psuIndex, uint8_t rule);
+void rampMessage_PolarityDone(uint8_t psuIndex, uint8_t result);
 void rampMessage_BeamOnSuccess();
 
 void statusMessageOff();
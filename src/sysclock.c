@@ -2,6 +2,10 @@
 #include <avr/interrupt.h>
 #include <math.h>
 #include <util/twi.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "./sysclock.h"
 
 /*
     ================
@@ -26,6 +30,7 @@ static volatile unsigned long int systemMonotonicOverflowCnt   = 0;
 */
 ISR(TIMER0_OVF_vect) {
         unsigned long int m, f;
+        SYSCLOCK_ISR_ENTER();
 
         m = systemMillis;
         f = systemMilliFractional;
@@ -42,6 +47,8 @@ ISR(TIMER0_OVF_vect) {
 
         systemMillis = m;
         systemMilliFractional = f;
+
+        SYSCLOCK_ISR_LEAVE(SYSCLOCK_ISR_TIMER0_OVF);
 }
 
 /*@
@@ -102,7 +109,70 @@ void delay(unsigned long millisecs) {
         return;
 }
 
+#ifdef SYSCLOCK_ISR_STATISTICS
+    /*
+            ISR accounting
+    */
+    static struct sysclockISRStatistics sysclockISRStats[SYSCLOCK_ISR_COUNT];
+    static unsigned long int sysclockISRStatsStart;
+
+    /*@
+            requires (isr >= 0) && (isr < SYSCLOCK_ISR_COUNT);
+            assigns sysclockISRStats[isr];
+    */
+    void sysclockISRAccount(uint8_t isr, uint16_t enterTimestamp) {
+            uint16_t cycles = TCNT1 - enterTimestamp;
+            struct sysclockISRStatistics* lpStat = &(sysclockISRStats[isr]);
+
+            lpStat->count = lpStat->count + 1;
+            if(lpStat->cycles <= (ULONG_MAX - cycles)) {
+                    lpStat->cycles = lpStat->cycles + cycles;
+            } else {
+                    lpStat->cycles = ULONG_MAX;
+            }
+            if(cycles > lpStat->maxCycles) {
+                    lpStat->maxCycles = cycles;
+            }
+    }
+
+    /*@
+            requires \valid(&(lpOut[0 .. SYSCLOCK_ISR_COUNT-1]));
+            assigns lpOut[0 .. SYSCLOCK_ISR_COUNT-1];
+            assigns sysclockISRStats[0 .. SYSCLOCK_ISR_COUNT-1];
+            assigns sysclockISRStatsStart;
+    */
+    unsigned long int sysclockISRStatisticsFetch(struct sysclockISRStatistics* lpOut) {
+            unsigned long int i;
+            unsigned long int now = micros();
+            unsigned long int elapsed;
+            uint8_t srOld = SREG;
+
+            #ifndef FRAMAC_SKIP
+                    cli();
+            #endif
+            for(i = 0; i < SYSCLOCK_ISR_COUNT; i=i+1) {
+                    lpOut[i] = sysclockISRStats[i];
+                    sysclockISRStats[i].count = 0;
+                    sysclockISRStats[i].cycles = 0;
+                    sysclockISRStats[i].maxCycles = 0;
+            }
+            SREG = srOld;
+
+            elapsed = now - sysclockISRStatsStart;
+            sysclockISRStatsStart = now;
+
+            return elapsed;
+    }
+#endif
+
 void sysclockInit() {
+    #ifdef SYSCLOCK_ISR_STATISTICS
+        TCCR1B = 0x00;          /* Stop timer 1 */
+        TCCR1A = 0x00;          /* Normal mode, free running cycle counter for ISR accounting */
+        TCNT1  = 0x0000;
+        TCCR1B = 0x01;          /* No prescaler */
+    #endif
+
     TCCR0B = 0x00;          /* Disable timer 0 */
     TCNT0  = 0x00;          /* Reset counter */
 
@@ -3,6 +3,7 @@
 
 /*@
         assigns TCCR0B, TCNT0, TCCR0A, TIFR0, TIMSK0, TCCR0B;
+        assigns TCCR1A, TCCR1B, TCNT1;
 
         ensures TCCR0B == 0x00;
         ensures TCNT0 == 0x00;
@@ -26,4 +27,57 @@ unsigned long int micros();
 */
 void delay(unsigned long millisecs);
 
+/*
+    ISR execution time accounting
+
+        Timer 1 runs free at the CPU clock (no interrupts) and serves as
+        cycle counter. Every accounted ISR takes a timestamp on entry
+        (SYSCLOCK_ISR_ENTER) and adds the elapsed cycles to its record on
+        exit (SYSCLOCK_ISR_LEAVE). Since timer 1 wraps after 65536 cycles
+        (4 ms) no ISR may run longer than this without being misaccounted.
+
+        Accounting costs a call (and the register saves it forces) in
+        every ISR, so it is only compiled in when SYSCLOCK_ISR_STATISTICS
+        is defined (diagnostic builds, "make ISRSTATS=1"). Otherwise ENTER
+        and LEAVE expand to nothing and isrstats / pwmbench are not
+        available.
+*/
+#define SYSCLOCK_ISR_ADC                0
+#define SYSCLOCK_ISR_TIMER0_OVF         1
+#define SYSCLOCK_ISR_TIMER2_COMPA       2
+#define SYSCLOCK_ISR_USART0_RX          3
+#define SYSCLOCK_ISR_USART0_UDRE        4
+#define SYSCLOCK_ISR_USART1_RX          5
+#define SYSCLOCK_ISR_USART1_UDRE        6
+#define SYSCLOCK_ISR_USART2_RX          7
+#define SYSCLOCK_ISR_USART2_UDRE        8
+#define SYSCLOCK_ISR_PCINT2             9
+#define SYSCLOCK_ISR_COUNT              10
+
+struct sysclockISRStatistics {
+    unsigned long int count;
+    unsigned long int cycles;           /* Cumulative (saturating) */
+    uint16_t maxCycles;
+};
+
+#ifdef SYSCLOCK_ISR_STATISTICS
+    #define SYSCLOCK_ISR_ENTER() uint16_t sysclockISREnterTimestamp = TCNT1
+    #define SYSCLOCK_ISR_LEAVE(isr) sysclockISRAccount((isr), sysclockISREnterTimestamp)
+
+    /*@
+            requires (isr >= 0) && (isr < SYSCLOCK_ISR_COUNT);
+    */
+    void sysclockISRAccount(uint8_t isr, uint16_t enterTimestamp);
+
+    /*
+            Copies the statistics of all ISRs (SYSCLOCK_ISR_COUNT entries)
+            and restarts accounting. Returns the microseconds covered by the
+            copied statistics
+    */
+    unsigned long int sysclockISRStatisticsFetch(struct sysclockISRStatistics* lpOut);
+#else
+    #define SYSCLOCK_ISR_ENTER()
+    #define SYSCLOCK_ISR_LEAVE(isr)
+#endif
+
 #endif /* __is_included__eb42c25c_df0f_11eb_ba7e_b499badf00a1 */
@@ -0,0 +1,138 @@
+/*
+    Host test of the Q16 calibration arithmetic (src/adccal.c)
+
+        Compares adcCalibrationQ16Apply against the double precision
+        calibration the readouts used before (k * counts + d with k per
+        10 bit count, floored and saturated to 0 ... 65535) for all codes of
+        plain 10 bit readings and of readings with TEST_FRACTION_BITS
+        oversampling fraction bits. This is done for the default
+        calibration and for pseudo random k / d pairs inside the non
+        saturating range. Results may differ by at most one count.
+        adcCalibrationQ16Inverse has to return the smallest code that is
+        converted into at least the requested value.
+
+        Built and run with "make test"
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "../src/adccal.h"
+
+#define TEST_RANDOM_CALIBRATIONS    20000
+#define TEST_MAX_DIFFERENCE         1
+#define TEST_FRACTION_BITS          3           /* ADC_OVERSAMPLED_BITS - 10 */
+
+/* Defaults of cfgeepromDefaults (adcVoltsPerCount / adcTenthMicroampsPerCount in psu.c) */
+static const double testDefaultK[] = { 3.221407, 9.765625 };
+
+static uint32_t testRandomState = 0x12345678;
+
+static uint32_t testRandom() {
+    /* xorshift32, fixed seed so failures are reproducible */
+    testRandomState = testRandomState ^ (testRandomState << 13);
+    testRandomState = testRandomState ^ (testRandomState >> 17);
+    testRandomState = testRandomState ^ (testRandomState << 5);
+    return testRandomState;
+}
+
+static double testRandomRange(
+    double min,
+    double max
+) {
+    return min + (max - min) * ((double)testRandom() / 4294967295.0);
+}
+
+static uint16_t testReference(
+    double k,
+    double d,
+    uint8_t fractionBits,
+    uint16_t adcCounts
+) {
+    double value = floor(k * (double)adcCounts / (double)(1 << fractionBits) + d);
+
+    if(value < 0) {
+        return 0;
+    }
+    if(value > 65535.0) {
+        return 0xFFFF;
+    }
+    return (uint16_t)value;
+}
+
+static unsigned long int testCheckCalibration(
+    double k,
+    double d,
+    uint8_t fractionBits
+) {
+    struct adcCalibrationQ16 cal;
+    unsigned long int failures = 0;
+    uint16_t i;
+    uint16_t q16;
+    uint16_t ref;
+    uint16_t inverse;
+    uint32_t value;
+
+    adcCalibrationQ16Set(&cal, k, d, fractionBits);
+    if(cal.countMax != (1024 << fractionBits) - 1) {
+        printf("FAIL countMax k=%f d=%f bits=%u: %u\n", k, d, fractionBits, cal.countMax);
+        return 1;
+    }
+
+    for(i = 0; i <= cal.countMax; i=i+1) {
+        q16 = adcCalibrationQ16Apply(&cal, i);
+        ref = testReference(k, d, fractionBits, i);
+        if(((q16 > ref) ? (q16 - ref) : (ref - q16)) > TEST_MAX_DIFFERENCE) {
+            printf("FAIL apply k=%f d=%f bits=%u code=%u: q16=%u double=%u\n", k, d, fractionBits, i, q16, ref);
+            failures = failures + 1;
+        }
+        if((i > 0) && (q16 < adcCalibrationQ16Apply(&cal, i - 1))) {
+            printf("FAIL monotonic k=%f d=%f bits=%u code=%u\n", k, d, fractionBits, i);
+            failures = failures + 1;
+        }
+    }
+
+    for(value = 0; value < 65536; value = value + 7) {
+        inverse = adcCalibrationQ16Inverse(&cal, (uint16_t)value);
+        if(adcCalibrationQ16Apply(&cal, inverse) < value) {
+            if(inverse != cal.countMax) {
+                printf("FAIL inverse k=%f d=%f bits=%u value=%lu: code %u too small\n", k, d, fractionBits, (unsigned long int)value, inverse);
+                failures = failures + 1;
+            }
+        } else if((inverse > 0) && (adcCalibrationQ16Apply(&cal, inverse - 1) >= value)) {
+            printf("FAIL inverse k=%f d=%f bits=%u value=%lu: code %u not minimal\n", k, d, fractionBits, (unsigned long int)value, inverse);
+            failures = failures + 1;
+        }
+    }
+
+    return failures;
+}
+
+int main() {
+    unsigned long int i;
+    unsigned long int failures = 0;
+    double k;
+    double d;
+
+    for(i = 0; i < sizeof(testDefaultK)/sizeof(double); i=i+1) {
+        failures = failures + testCheckCalibration(testDefaultK[i], 0, 0);
+        failures = failures + testCheckCalibration(testDefaultK[i], 0, TEST_FRACTION_BITS);
+    }
+
+    for(i = 0; i < TEST_RANDOM_CALIBRATIONS; i=i+1) {
+        k = testRandomRange(0.001, 64.0);
+        d = testRandomRange(-32000.0, 32000.0);
+        failures = failures + testCheckCalibration(k, d, 0);
+        failures = failures + testCheckCalibration(k, d, TEST_FRACTION_BITS);
+        if(failures > 100) {
+            break;
+        }
+    }
+
+    if(failures != 0) {
+        printf("adccal: %lu failures\n", failures);
+        return 1;
+    }
+    printf("adccal: %lu calibrations, 1024 and %u codes each, ok\n", i + sizeof(testDefaultK)/sizeof(double), 1024 << TEST_FRACTION_BITS);
+    return 0;
+}